@@ -0,0 +1,163 @@
+//========================================
+// Spans
+//========================================
+
+#define _GetAllocSpan(Ptr) ((alloc_span*)((usz)(Ptr) & ~(usz)(ALLOC_SPAN_SIZE-1)))
+
+internal alloc_span*
+_GetAlignedSpans(usz Size)
+{
+    // Over-allocates by one span, so that an aligned range of [Size] bytes fits in it.
+    buffer Mem = GetMemory(Size + ALLOC_SPAN_SIZE, NULL, MEM_WRITE);
+    if (!Mem.Base) return NULL;
+    
+    alloc_span* Result = (alloc_span*)(Align((usz)Mem.Base, ALLOC_SPAN_SIZE));
+    Result->Memory = Mem;
+    return Result;
+}
+
+internal u32
+_GetAllocClass(usz Size)
+{
+    // Class 0 holds objects of up to ALLOC_MIN_OBJECT bytes, and each class after it doubles.
+    u32 Result = (u32)GetLastBitSet((Size-1) | (ALLOC_MIN_OBJECT-1)) - (ALLOC_MIN_SHIFT-1);
+    return Result;
+}
+
+internal bool
+_NewAllocSpan(alloc_heap* Heap, u32 Class)
+{
+    if (Heap->Segment.WriteCur == Heap->Segment.Size)
+    {
+        alloc_span* First = _GetAlignedSpans(ALLOC_SEGMENT_SPANS * ALLOC_SPAN_SIZE);
+        if (!First) return false;
+        First->NextSegment = Heap->Segments;
+        Heap->Segments = First;
+        Heap->Segment = Buffer(First, 0, ALLOC_SEGMENT_SPANS * ALLOC_SPAN_SIZE);
+    }
+    
+    alloc_span* Span = (alloc_span*)PushIntoArena(&Heap->Segment, ALLOC_SPAN_SIZE);
+    Span->Owner = Heap;
+    Span->Class = Class;
+    Heap->Spans[Class] = Buffer(Span, ALLOC_SPAN_HEADER, ALLOC_SPAN_SIZE);
+    return true;
+}
+
+
+//========================================
+// Thread heaps
+//========================================
+
+global thread_local alloc_heap* _tAllocHeap = NULL;
+
+internal alloc_heap*
+_InitAllocHeap(void)
+{
+    alloc_span* First = _GetAlignedSpans(ALLOC_SEGMENT_SPANS * ALLOC_SPAN_SIZE);
+    if (!First) return NULL;
+    First->NextSegment = NULL;
+    
+    // The first span of the first segment holds the heap itself.
+    alloc_heap* Heap = (alloc_heap*)((u8*)First + ALLOC_SPAN_HEADER);
+    memset(Heap, 0, sizeof(alloc_heap));
+    InitMPSCFreeList(&Heap->RemoteFrees);
+    Heap->Segments = First;
+    Heap->Segment = Buffer(First, ALLOC_SPAN_SIZE, ALLOC_SEGMENT_SPANS * ALLOC_SPAN_SIZE);
+    
+    _tAllocHeap = Heap;
+    return Heap;
+}
+
+internal bool
+_CollectRemoteFrees(alloc_heap* Heap)
+{
+    bool Result = false;
+    mpsc_node* Node;
+    while ((Node = MPSCFreeListPop(&Heap->RemoteFrees)) != NULL)
+    {
+        u32 Class = _GetAllocSpan(Node)->Class;
+        Node->Next = Heap->Bins[Class];
+        Heap->Bins[Class] = Node;
+        Result = true;
+    }
+    return Result;
+}
+
+external void*
+ThreadAlloc(usz Size)
+{
+    if (Size-1 >= ALLOC_MAX_OBJECT)
+    {
+        if (!Size) return NULL;
+        alloc_span* Span = _GetAlignedSpans(ALLOC_SPAN_HEADER + Size);
+        if (!Span) return NULL;
+        Span->Owner = NULL;
+        Span->Class = ALLOC_CLASS_LARGE;
+        return (u8*)Span + ALLOC_SPAN_HEADER;
+    }
+    
+    alloc_heap* Heap = _tAllocHeap;
+    if (!Heap && !(Heap = _InitAllocHeap())) return NULL;
+    
+    u32 Class = _GetAllocClass(Size);
+    mpsc_node* Node = Heap->Bins[Class];
+    if (!Node && _CollectRemoteFrees(Heap))
+    {
+        Node = Heap->Bins[Class];
+    }
+    if (Node)
+    {
+        Heap->Bins[Class] = Node->Next;
+        return Node;
+    }
+    
+    usz ObjectSize = (usz)ALLOC_MIN_OBJECT << Class;
+    void* Result = PushIntoArena(&Heap->Spans[Class], ObjectSize);
+    if (!Result && _NewAllocSpan(Heap, Class))
+    {
+        Result = PushIntoArena(&Heap->Spans[Class], ObjectSize);
+    }
+    return Result;
+}
+
+external void
+ThreadFree(void* Ptr)
+{
+    if (!Ptr) return;
+    
+    alloc_span* Span = _GetAllocSpan(Ptr);
+    if (Span->Class == ALLOC_CLASS_LARGE)
+    {
+        buffer Mem = Span->Memory;
+        FreeMemory(&Mem);
+    }
+    else if (Span->Owner == _tAllocHeap)
+    {
+        mpsc_node* Node = (mpsc_node*)Ptr;
+        Node->Next = Span->Owner->Bins[Span->Class];
+        Span->Owner->Bins[Span->Class] = Node;
+    }
+    else
+    {
+        MPSCFreeListPush(&Span->Owner->RemoteFrees, Ptr);
+    }
+}
+
+external void
+CloseThreadHeap(void)
+{
+    alloc_heap* Heap = _tAllocHeap;
+    if (Heap)
+    {
+        // The heap lives in the last segment of the list, so it is read before any is freed.
+        alloc_span* Segment = Heap->Segments;
+        _tAllocHeap = NULL;
+        while (Segment)
+        {
+            alloc_span* Next = Segment->NextSegment;
+            buffer Mem = Segment->Memory;
+            FreeMemory(&Mem);
+            Segment = Next;
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef TINYBASE_ALLOC_H
+//=========================================================================
+// tinybase-alloc.h
+//
+// Module for a general-purpose allocator made for multithreaded code.
+// Each thread gets its own heap, with free lists per size class, so
+// allocating and freeing never takes a lock. Memory freed by a thread
+// other than the one that allocated it is pushed onto the owner heap's
+// MPSC free list, and the owner takes it back in batches.
+//=========================================================================
+#define TINYBASE_ALLOC_H
+
+#include "tinybase-types.h"
+#include "tinybase-platform.h"
+#include "tinybase-queues.h"
+
+
+//========================================
+// Spans
+//========================================
+
+#define ALLOC_SPAN_SIZE Kilobyte(64)
+#define ALLOC_SPAN_HEADER 64
+#define ALLOC_SEGMENT_SPANS 16
+#define ALLOC_MIN_SHIFT 4
+#define ALLOC_MIN_OBJECT (1 << ALLOC_MIN_SHIFT)
+#define ALLOC_NUM_CLASSES 10
+#define ALLOC_MAX_OBJECT (ALLOC_MIN_OBJECT << (ALLOC_NUM_CLASSES-1))
+#define ALLOC_CLASS_LARGE U32_MAX
+
+typedef struct alloc_span
+{
+    struct alloc_heap* Owner;
+    u32 Class;
+    struct alloc_span* NextSegment;
+    buffer Memory;
+} alloc_span;
+
+/* Header at the start of every ALLOC_SPAN_SIZE-aligned span, so that the span of any pointer
+ |  can be found by masking off its low bits. All objects in a span are of size class [.Class]
+ |  and belong to heap [.Owner]. Spans are carved out of segments of ALLOC_SEGMENT_SPANS
+ |  spans each, and the first span of a segment keeps the [.Memory] got from the system and
+ |  links to the next segment of the heap. Allocations bigger than ALLOC_MAX_OBJECT get a
+ |  span of their own, with [.Class] set to ALLOC_CLASS_LARGE and no owner. */
+
+
+//========================================
+// Thread heaps
+//========================================
+
+typedef struct alloc_heap
+{
+    mpsc_freelist RemoteFrees;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(mpsc_freelist) % CACHE_LINE_SIZE];
+    mpsc_node* Bins[ALLOC_NUM_CLASSES];
+    buffer Spans[ALLOC_NUM_CLASSES];
+    buffer Segment;
+    alloc_span* Segments;
+} alloc_heap;
+
+/* Heap owned by a single thread. [.Bins] holds the freed objects of each size class, and
+ |  [.Spans] the span each class is currently carving new objects from. [.RemoteFrees] is
+ |  the only field other threads touch, and sits on a cache line of its own. The heap itself
+ |  lives in the first span of its first segment. */
+
+external void* ThreadAlloc(usz Size);
+
+/* Gets a region of at least [Size] bytes from the calling thread's heap, setting the heap
+ |  up on first use. Sizes up to ALLOC_MAX_OBJECT are rounded up to a power of two, and
+ |  bigger ones go straight to GetMemory(). Regions are aligned to 16 bytes, and their
+ |  contents are undefined.
+ |--- Return: pointer to the region if successful, NULL if not. */
+
+external void ThreadFree(void* Ptr);
+
+/* Frees a region got from ThreadAlloc(), from any thread. If the region belongs to another
+ |  thread's heap, it is queued for that thread to take back on a later ThreadAlloc(). [Ptr]
+ |  can be NULL.
+ |--- Return: nothing. */
+
+external void CloseThreadHeap(void);
+
+/* Returns all memory of the calling thread's heap to the system. Every region allocated by
+ |  the thread must have been freed before this, including the ones passed to other threads.
+ |  Call before the thread exits, if it used ThreadAlloc().
+ |--- Return: nothing. */
+
+
+#if !defined(TT_STATIC_LINKING)
+#include "tinybase-alloc.c"
+#endif
+
+#endif //TINYBASE_ALLOC_H
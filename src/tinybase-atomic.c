@@ -1,61 +1,173 @@
+//========================================
+// Memory Order
+//========================================
+
+#if defined(TT_GCC) || defined(TT_CLANG)
+// The builtins only honour the memory order if it is a compile-time constant, and use
+// seq_cst otherwise, so each order gets its own call. The functions are external, so the
+// switch stays in unless the compiler inlines them into a call with a constant order.
+# define _ATOMIC_CALL(Result, Order, Builtin, ...) \
+    switch (Order) \
+    { \
+        case ATOMIC_RELAXED: Result = Builtin(__VA_ARGS__, __ATOMIC_RELAXED); break; \
+        case ATOMIC_ACQUIRE: Result = Builtin(__VA_ARGS__, __ATOMIC_ACQUIRE); break; \
+        case ATOMIC_RELEASE: Result = Builtin(__VA_ARGS__, __ATOMIC_RELEASE); break; \
+        case ATOMIC_ACQ_REL: Result = Builtin(__VA_ARGS__, __ATOMIC_ACQ_REL); break; \
+        default:             Result = Builtin(__VA_ARGS__, __ATOMIC_SEQ_CST); break; \
+    }
+// Loads can't release, and stores can't acquire, so those orders are strengthened.
+# define _ATOMIC_LOAD(Result, Order, Src) \
+    switch (Order) \
+    { \
+        case ATOMIC_RELAXED: Result = __atomic_load_n(Src, __ATOMIC_RELAXED); break; \
+        case ATOMIC_SEQ_CST: Result = __atomic_load_n(Src, __ATOMIC_SEQ_CST); break; \
+        default:             Result = __atomic_load_n(Src, __ATOMIC_ACQUIRE); break; \
+    }
+# define _ATOMIC_STORE(Order, Dst, Value) \
+    switch (Order) \
+    { \
+        case ATOMIC_RELAXED: __atomic_store_n(Dst, Value, __ATOMIC_RELAXED); break; \
+        case ATOMIC_SEQ_CST: __atomic_store_n(Dst, Value, __ATOMIC_SEQ_CST); break; \
+        default:             __atomic_store_n(Dst, Value, __ATOMIC_RELEASE); break; \
+    }
+// A failed compare-exchange is only a load, so it gets the load half of the order.
+# define _ATOMIC_CAS(Result, Order, Dst, Compare, Value) \
+    switch (Order) \
+    { \
+        case ATOMIC_RELAXED: \
+        Result = __atomic_compare_exchange_n(Dst, Compare, Value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED); break; \
+        case ATOMIC_ACQUIRE: \
+        Result = __atomic_compare_exchange_n(Dst, Compare, Value, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE); break; \
+        case ATOMIC_RELEASE: \
+        Result = __atomic_compare_exchange_n(Dst, Compare, Value, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED); break; \
+        case ATOMIC_ACQ_REL: \
+        Result = __atomic_compare_exchange_n(Dst, Compare, Value, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); break; \
+        default: \
+        Result = __atomic_compare_exchange_n(Dst, Compare, Value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); break; \
+    }
+#endif
+
+external void
+AtomicFence(i32 Order)
+{
+#if defined(TT_MSVC)
+    if (Order == ATOMIC_SEQ_CST) MemoryBarrier();
+    else if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    switch (Order)
+    {
+        case ATOMIC_RELAXED: break;
+        case ATOMIC_ACQUIRE: __atomic_thread_fence(__ATOMIC_ACQUIRE); break;
+        case ATOMIC_RELEASE: __atomic_thread_fence(__ATOMIC_RELEASE); break;
+        case ATOMIC_ACQ_REL: __atomic_thread_fence(__ATOMIC_ACQ_REL); break;
+        default:             __atomic_thread_fence(__ATOMIC_SEQ_CST); break;
+    }
+#else // Reserved for other compilers.
+#endif
+}
+
+
 //========================================
 // Exchange
 //========================================
 
 external i16
 AtomicExchange16(void* volatile Dst, i16 Value)
+{
+    i16 OldValue = AtomicExchange16Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return OldValue;
+}
+
+external i32
+AtomicExchange32(void* volatile Dst, i32 Value)
+{
+    i32 OldValue = AtomicExchange32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return OldValue;
+}
+
+external i64
+AtomicExchange64(void* volatile Dst, i64 Value)
+{
+    i64 OldValue = AtomicExchange64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return OldValue;
+}
+
+external isz
+AtomicExchangeIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    isz OldValue = (isz)AtomicExchange64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#else
+    isz OldValue = (isz)AtomicExchange32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#endif
+    return OldValue;
+}
+
+external void*
+AtomicExchangePtr(void* volatile* Dst, void* Value)
+{
+    void* OldValue = AtomicExchangePtrExplicit(Dst, Value, ATOMIC_ACQ_REL);
+    return OldValue;
+}
+
+external i16
+AtomicExchange16Explicit(void* volatile Dst, i16 Value, i32 Order)
 {
 #if defined(TT_MSVC)
     i16 OldValue = (i16)InterlockedExchange16((SHORT* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i16 OldValue = __atomic_exchange_n((i16* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 OldValue;
+    _ATOMIC_CALL(OldValue, Order, __atomic_exchange_n, (i16* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return OldValue;
 }
 
 external i32
-AtomicExchange32(void* volatile Dst, i32 Value)
+AtomicExchange32Explicit(void* volatile Dst, i32 Value, i32 Order)
 {
 #if defined(TT_MSVC)
     i32 OldValue = InterlockedExchange((LONG* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i32 OldValue = __atomic_exchange_n((i32* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 OldValue;
+    _ATOMIC_CALL(OldValue, Order, __atomic_exchange_n, (i32* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return OldValue;
 }
 
 external i64
-AtomicExchange64(void* volatile Dst, i64 Value)
+AtomicExchange64Explicit(void* volatile Dst, i64 Value, i32 Order)
 {
 #if defined(TT_MSVC)
     i64 OldValue = InterlockedExchange64((LONG64* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i64 OldValue = __atomic_exchange_n((i64* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 OldValue;
+    _ATOMIC_CALL(OldValue, Order, __atomic_exchange_n, (i64* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return OldValue;
 }
 
 external isz
-AtomicExchangeIsz(void* volatile Dst, isz Value)
+AtomicExchangeIszExplicit(void* volatile Dst, isz Value, i32 Order)
 {
 #if defined(TT_X64)
-    isz OldValue = (isz)AtomicExchange64(Dst, Value);
+    isz OldValue = (isz)AtomicExchange64Explicit(Dst, Value, Order);
 #else
-    isz OldValue = (isz)AtomicExchange32(Dst, Value);
+    isz OldValue = (isz)AtomicExchange32Explicit(Dst, Value, Order);
 #endif
     return OldValue;
 }
 
 external void*
-AtomicExchangePtr(void* volatile* Dst, void* Value)
+AtomicExchangePtrExplicit(void* volatile* Dst, void* Value, i32 Order)
 {
 #if defined(TT_MSVC)
     void* OldValue = InterlockedExchangePointer(Dst, Value);
-#elif defined(TT_GCC)
-    void* OldValue = __atomic_exchange_n(Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    void* OldValue;
+    _ATOMIC_CALL(OldValue, Order, __atomic_exchange_n, Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return OldValue;
@@ -63,76 +175,131 @@ AtomicExchangePtr(void* volatile* Dst, void* Value)
 
 
 //========================================
-// Compate Exchange
+// Compare Exchange
 //========================================
 
 external bool
 AtomicCompareExchange16(void* volatile Dst, i16 Compare, i16 Value)
+{
+    bool Result = AtomicCompareExchange16Explicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external bool
+AtomicCompareExchange32(void* volatile Dst, i32 Compare, i32 Value)
+{
+    bool Result = AtomicCompareExchange32Explicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external bool
+AtomicCompareExchange64(void* volatile Dst, i64 Compare, i64 Value)
+{
+    bool Result = AtomicCompareExchange64Explicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external bool
+AtomicCompareExchangeIsz(void* volatile Dst, isz Compare, isz Value)
+{
+#if defined(TT_X64)
+    bool Result = AtomicCompareExchange64Explicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+#else
+    bool Result = AtomicCompareExchange32Explicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+#endif
+    return Result;
+}
+
+external bool
+AtomicCompareExchangePtr(void* volatile* Dst, void* Compare, void* Value)
+{
+    bool Result = AtomicCompareExchangePtrExplicit(Dst, Compare, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external bool
+AtomicCompareExchange16Explicit(void* volatile Dst, i16 Compare, i16 Value, i32 Order)
 {
 #if defined(TT_MSVC)
-    InterlockedCompareExchange16((SHORT* volatile)Dst, Value, Compare);
-    bool Result = true;
-#elif defined(TT_GCC)
-    bool Result = __atomic_compare_exchange_n((i16* volatile)Dst, &Compare, Value, 0,
-                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    bool Result = (InterlockedCompareExchange16((SHORT* volatile)Dst, Value, Compare) == Compare);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    bool Result;
+    _ATOMIC_CAS(Result, Order, (i16* volatile)Dst, &Compare, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external bool
-AtomicCompareExchange32(void* volatile Dst, i32 Compare, i32 Value)
+AtomicCompareExchange32Explicit(void* volatile Dst, i32 Compare, i32 Value, i32 Order)
 {
 #if defined(TT_MSVC)
-    InterlockedCompareExchange((LONG* volatile)Dst, Value, Compare);
-    bool Result = true;
-#elif defined(TT_GCC)
-    bool Result = __atomic_compare_exchange_n((i32* volatile)Dst, &Compare, Value, 0,
-                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    bool Result = (InterlockedCompareExchange((LONG* volatile)Dst, Value, Compare) == Compare);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    bool Result;
+    _ATOMIC_CAS(Result, Order, (i32* volatile)Dst, &Compare, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external bool
-AtomicCompareExchange64(void* volatile Dst, i64 Compare, i64 Value)
+AtomicCompareExchange64Explicit(void* volatile Dst, i64 Compare, i64 Value, i32 Order)
 {
 #if defined(TT_MSVC)
-    InterlockedCompareExchange64((LONG64* volatile)Dst, Value, Compare);
-    bool Result = true;
-#elif defined(TT_GCC)
-    bool Result = __atomic_compare_exchange_n((i64* volatile)Dst, &Compare, Value, 0,
-                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    bool Result = (InterlockedCompareExchange64((LONG64* volatile)Dst, Value, Compare) == Compare);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    bool Result;
+    _ATOMIC_CAS(Result, Order, (i64* volatile)Dst, &Compare, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external bool
-AtomicCompareExchangeisz(void* volatile Dst, isz Compare, isz Value)
+AtomicCompareExchangeIszExplicit(void* volatile Dst, isz Compare, isz Value, i32 Order)
 {
 #if defined(TT_X64)
-    bool Result = AtomicCompareExchange64(Dst, Compare, Value);
+    bool Result = AtomicCompareExchange64Explicit(Dst, Compare, Value, Order);
 #else
-    bool Result = AtomicCompareExchange32(Dst, Compare, Value);
+    bool Result = AtomicCompareExchange32Explicit(Dst, Compare, Value, Order);
 #endif
     return Result;
 }
 
 external bool
-AtomicCompareExchangePtr(void* volatile* Dst, void* Compare, void* Value)
+AtomicCompareExchangePtrExplicit(void* volatile* Dst, void* Compare, void* Value, i32 Order)
 {
 #if defined(TT_MSVC)
-    InterlockedCompareExchangePointer(Dst, Value, Compare);
-    bool Result = true;
-#elif defined(TT_GCC)
-    bool Result = __atomic_compare_exchange_n(Dst, &Compare, Value, 0,
-                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    bool Result = (InterlockedCompareExchangePointer(Dst, Value, Compare) == Compare);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    bool Result;
+    _ATOMIC_CAS(Result, Order, Dst, &Compare, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
+external bool
+AtomicCompareExchange128(void* volatile Dst, i64* Compare, i64 ValueLo, i64 ValueHi)
+{
+#if defined(TT_X64)
+# if defined(TT_MSVC)
+    bool Result = _InterlockedCompareExchange128((__int64 volatile*)Dst, ValueHi, ValueLo, Compare);
+# elif defined(TT_GCC) || defined(TT_CLANG)
+    bool Result;
+    __asm__ __volatile__("lock cmpxchg16b %1"
+                         : "=@ccz"(Result), "+m"(*(i64 volatile(*)[2])Dst),
+                           "+a"(Compare[0]), "+d"(Compare[1])
+                         : "b"(ValueLo), "c"(ValueHi)
+                         : "memory");
+# else // Reserved for other compilers.
+# endif
+#else // Reserved for other architectures.
+#endif
+    return Result;
+}
+
 
 //========================================
 // Add and Fetch
@@ -140,59 +307,667 @@ AtomicCompareExchangePtr(void* volatile* Dst, void* Compare, void* Value)
 
 external i16
 AtomicAddFetch16(void* volatile Dst, i16 Value)
+{
+    i16 Result = AtomicAddFetch16Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i32
+AtomicAddFetch32(void* volatile Dst, i32 Value)
+{
+    i32 Result = AtomicAddFetch32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i64
+AtomicAddFetch64(void* volatile Dst, i64 Value)
+{
+    i64 Result = AtomicAddFetch64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external isz
+AtomicAddFetchIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicAddFetch64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#else
+    isz Result = (isz)AtomicAddFetch32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#endif
+    return Result;
+}
+
+external void*
+AtomicAddFetchPtr(void* volatile* Dst, isz Value)
+{
+    void* Result = AtomicAddFetchPtrExplicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i16
+AtomicAddFetch16Explicit(void* volatile Dst, i16 Value, i32 Order)
 {
 #if defined(TT_MSVC)
-    i16 Result = (i16)InterlockedAdd((LONG* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i16 Result = __atomic_add_fetch((i16* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+    i16 Result = (i16)(InterlockedExchangeAdd16((SHORT* volatile)Dst, Value) + Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_add_fetch, (i16* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external i32
-AtomicAddFetch32(void* volatile Dst, i32 Value)
+AtomicAddFetch32Explicit(void* volatile Dst, i32 Value, i32 Order)
 {
 #if defined(TT_MSVC)
     i32 Result = InterlockedAdd((LONG* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i32 Result = __atomic_add_fetch((i32* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_add_fetch, (i32* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external i64
-AtomicAddFetch64(void* volatile Dst, i64 Value)
+AtomicAddFetch64Explicit(void* volatile Dst, i64 Value, i32 Order)
 {
 #if defined(TT_MSVC)
     i64 Result = InterlockedAdd64((LONG64* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    i64 Result = __atomic_add_fetch((i64* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_add_fetch, (i64* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
 
 external isz
-AtomicAddFetchIsz(void* volatile Dst, isz Value)
+AtomicAddFetchIszExplicit(void* volatile Dst, isz Value, i32 Order)
 {
 #if defined(TT_X64)
-    isz Result = (isz)AtomicAddFetch64(Dst, Value);
+    isz Result = (isz)AtomicAddFetch64Explicit(Dst, Value, Order);
 #else
-    isz Result = (isz)AtomicAddFetch32(Dst, Value);
+    isz Result = (isz)AtomicAddFetch32Explicit(Dst, Value, Order);
 #endif
     return Result;
 }
 
 external void*
-AtomicAddFetchPtr(void* volatile* Dst, isz Value)
+AtomicAddFetchPtrExplicit(void* volatile* Dst, isz Value, i32 Order)
 {
 #if defined(TT_MSVC)
     void* Result = (void*)InterlockedAdd64((LONG64* volatile)Dst, Value);
-#elif defined(TT_GCC)
-    void* Result = (void*)__atomic_add_fetch((isz* volatile)Dst, Value, __ATOMIC_ACQ_REL);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    void* Result;
+    _ATOMIC_CALL(Result, Order, (void*)__atomic_add_fetch, (isz* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+
+//========================================
+// Fetch Bitwise
+//========================================
+
+external i16
+AtomicFetchOr16(void* volatile Dst, i16 Value)
+{
+    i16 Result = AtomicFetchOr16Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i32
+AtomicFetchOr32(void* volatile Dst, i32 Value)
+{
+    i32 Result = AtomicFetchOr32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i64
+AtomicFetchOr64(void* volatile Dst, i64 Value)
+{
+    i64 Result = AtomicFetchOr64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external isz
+AtomicFetchOrIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchOr64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#else
+    isz Result = (isz)AtomicFetchOr32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#endif
+    return Result;
+}
+
+external i16
+AtomicFetchOr16Explicit(void* volatile Dst, i16 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i16 Result = (i16)InterlockedOr16((SHORT* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_or, (i16* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i32
+AtomicFetchOr32Explicit(void* volatile Dst, i32 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i32 Result = InterlockedOr((LONG* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_or, (i32* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i64
+AtomicFetchOr64Explicit(void* volatile Dst, i64 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i64 Result = InterlockedOr64((LONG64* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_or, (i64* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external isz
+AtomicFetchOrIszExplicit(void* volatile Dst, isz Value, i32 Order)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchOr64Explicit(Dst, Value, Order);
+#else
+    isz Result = (isz)AtomicFetchOr32Explicit(Dst, Value, Order);
+#endif
+    return Result;
+}
+
+external i16
+AtomicFetchAnd16(void* volatile Dst, i16 Value)
+{
+    i16 Result = AtomicFetchAnd16Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i32
+AtomicFetchAnd32(void* volatile Dst, i32 Value)
+{
+    i32 Result = AtomicFetchAnd32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i64
+AtomicFetchAnd64(void* volatile Dst, i64 Value)
+{
+    i64 Result = AtomicFetchAnd64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external isz
+AtomicFetchAndIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchAnd64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#else
+    isz Result = (isz)AtomicFetchAnd32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#endif
+    return Result;
+}
+
+external i16
+AtomicFetchAnd16Explicit(void* volatile Dst, i16 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i16 Result = (i16)InterlockedAnd16((SHORT* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_and, (i16* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i32
+AtomicFetchAnd32Explicit(void* volatile Dst, i32 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i32 Result = InterlockedAnd((LONG* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_and, (i32* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i64
+AtomicFetchAnd64Explicit(void* volatile Dst, i64 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i64 Result = InterlockedAnd64((LONG64* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_and, (i64* volatile)Dst, Value);
 #else // Reserved for other compilers.
 #endif
     return Result;
 }
+
+external isz
+AtomicFetchAndIszExplicit(void* volatile Dst, isz Value, i32 Order)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchAnd64Explicit(Dst, Value, Order);
+#else
+    isz Result = (isz)AtomicFetchAnd32Explicit(Dst, Value, Order);
+#endif
+    return Result;
+}
+
+external i16
+AtomicFetchXor16(void* volatile Dst, i16 Value)
+{
+    i16 Result = AtomicFetchXor16Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i32
+AtomicFetchXor32(void* volatile Dst, i32 Value)
+{
+    i32 Result = AtomicFetchXor32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external i64
+AtomicFetchXor64(void* volatile Dst, i64 Value)
+{
+    i64 Result = AtomicFetchXor64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+    return Result;
+}
+
+external isz
+AtomicFetchXorIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchXor64Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#else
+    isz Result = (isz)AtomicFetchXor32Explicit(Dst, Value, ATOMIC_ACQ_REL);
+#endif
+    return Result;
+}
+
+external i16
+AtomicFetchXor16Explicit(void* volatile Dst, i16 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i16 Result = (i16)InterlockedXor16((SHORT* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_xor, (i16* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i32
+AtomicFetchXor32Explicit(void* volatile Dst, i32 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i32 Result = InterlockedXor((LONG* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_xor, (i32* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i64
+AtomicFetchXor64Explicit(void* volatile Dst, i64 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    i64 Result = InterlockedXor64((LONG64* volatile)Dst, Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 Result;
+    _ATOMIC_CALL(Result, Order, __atomic_fetch_xor, (i64* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external isz
+AtomicFetchXorIszExplicit(void* volatile Dst, isz Value, i32 Order)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicFetchXor64Explicit(Dst, Value, Order);
+#else
+    isz Result = (isz)AtomicFetchXor32Explicit(Dst, Value, Order);
+#endif
+    return Result;
+}
+
+
+//========================================
+// Load and Store
+//========================================
+
+external i16
+AtomicLoad16(void* volatile Src)
+{
+    i16 Result = AtomicLoad16Explicit(Src, ATOMIC_ACQUIRE);
+    return Result;
+}
+
+external i32
+AtomicLoad32(void* volatile Src)
+{
+    i32 Result = AtomicLoad32Explicit(Src, ATOMIC_ACQUIRE);
+    return Result;
+}
+
+external i64
+AtomicLoad64(void* volatile Src)
+{
+    i64 Result = AtomicLoad64Explicit(Src, ATOMIC_ACQUIRE);
+    return Result;
+}
+
+external isz
+AtomicLoadIsz(void* volatile Src)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicLoad64Explicit(Src, ATOMIC_ACQUIRE);
+#else
+    isz Result = (isz)AtomicLoad32Explicit(Src, ATOMIC_ACQUIRE);
+#endif
+    return Result;
+}
+
+external void*
+AtomicLoadPtr(void* volatile* Src)
+{
+    void* Result = AtomicLoadPtrExplicit(Src, ATOMIC_ACQUIRE);
+    return Result;
+}
+
+external void
+AtomicStore16(void* volatile Dst, i16 Value)
+{
+    AtomicStore16Explicit(Dst, Value, ATOMIC_RELEASE);
+}
+
+external void
+AtomicStore32(void* volatile Dst, i32 Value)
+{
+    AtomicStore32Explicit(Dst, Value, ATOMIC_RELEASE);
+}
+
+external void
+AtomicStore64(void* volatile Dst, i64 Value)
+{
+    AtomicStore64Explicit(Dst, Value, ATOMIC_RELEASE);
+}
+
+external void
+AtomicStoreIsz(void* volatile Dst, isz Value)
+{
+#if defined(TT_X64)
+    AtomicStore64Explicit(Dst, Value, ATOMIC_RELEASE);
+#else
+    AtomicStore32Explicit(Dst, Value, ATOMIC_RELEASE);
+#endif
+}
+
+external void
+AtomicStorePtr(void* volatile* Dst, void* Value)
+{
+    AtomicStorePtrExplicit(Dst, Value, ATOMIC_RELEASE);
+}
+
+external i16
+AtomicLoad16Explicit(void* volatile Src, i32 Order)
+{
+#if defined(TT_MSVC)
+    i16 Result = *(i16 volatile*)Src;
+    if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i16 Result;
+    _ATOMIC_LOAD(Result, Order, (i16* volatile)Src);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i32
+AtomicLoad32Explicit(void* volatile Src, i32 Order)
+{
+#if defined(TT_MSVC)
+    i32 Result = *(i32 volatile*)Src;
+    if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result;
+    _ATOMIC_LOAD(Result, Order, (i32* volatile)Src);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external i64
+AtomicLoad64Explicit(void* volatile Src, i32 Order)
+{
+#if defined(TT_MSVC)
+    i64 Result = *(i64 volatile*)Src;
+    if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i64 Result;
+    _ATOMIC_LOAD(Result, Order, (i64* volatile)Src);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external isz
+AtomicLoadIszExplicit(void* volatile Src, i32 Order)
+{
+#if defined(TT_X64)
+    isz Result = (isz)AtomicLoad64Explicit(Src, Order);
+#else
+    isz Result = (isz)AtomicLoad32Explicit(Src, Order);
+#endif
+    return Result;
+}
+
+external void*
+AtomicLoadPtrExplicit(void* volatile* Src, i32 Order)
+{
+#if defined(TT_MSVC)
+    void* Result = *Src;
+    if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    void* Result;
+    _ATOMIC_LOAD(Result, Order, Src);
+#else // Reserved for other compilers.
+#endif
+    return Result;
+}
+
+external void
+AtomicStore16Explicit(void* volatile Dst, i16 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    if (Order == ATOMIC_SEQ_CST) InterlockedExchange16((SHORT* volatile)Dst, Value);
+    else
+    {
+        if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+        *(i16 volatile*)Dst = Value;
+    }
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    _ATOMIC_STORE(Order, (i16* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+}
+
+external void
+AtomicStore32Explicit(void* volatile Dst, i32 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    if (Order == ATOMIC_SEQ_CST) InterlockedExchange((LONG* volatile)Dst, Value);
+    else
+    {
+        if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+        *(i32 volatile*)Dst = Value;
+    }
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    _ATOMIC_STORE(Order, (i32* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+}
+
+external void
+AtomicStore64Explicit(void* volatile Dst, i64 Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    if (Order == ATOMIC_SEQ_CST) InterlockedExchange64((LONG64* volatile)Dst, Value);
+    else
+    {
+        if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+        *(i64 volatile*)Dst = Value;
+    }
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    _ATOMIC_STORE(Order, (i64* volatile)Dst, Value);
+#else // Reserved for other compilers.
+#endif
+}
+
+external void
+AtomicStoreIszExplicit(void* volatile Dst, isz Value, i32 Order)
+{
+#if defined(TT_X64)
+    AtomicStore64Explicit(Dst, Value, Order);
+#else
+    AtomicStore32Explicit(Dst, Value, Order);
+#endif
+}
+
+external void
+AtomicStorePtrExplicit(void* volatile* Dst, void* Value, i32 Order)
+{
+#if defined(TT_MSVC)
+    if (Order == ATOMIC_SEQ_CST) InterlockedExchangePointer(Dst, Value);
+    else
+    {
+        if (Order != ATOMIC_RELAXED) _ReadWriteBarrier();
+        *Dst = Value;
+    }
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    _ATOMIC_STORE(Order, Dst, Value);
+#else // Reserved for other compilers.
+#endif
+}
+
+
+//========================================
+// Locks
+//========================================
+
+#define SPINLOCK_MAX_BACKOFF 64
+
+external bool
+TryLockSpinlock(spinlock* Lock)
+{
+    bool Result = (AtomicLoad32(&Lock->State) == 0
+                   && AtomicExchange32(&Lock->State, 1) == 0);
+    return Result;
+}
+
+external void
+LockSpinlock(spinlock* Lock)
+{
+    i32 Backoff = 1;
+    while (!TryLockSpinlock(Lock))
+    {
+        for (i32 Count = 0; Count < Backoff; Count++)
+        {
+            CpuPause();
+        }
+        if (Backoff < SPINLOCK_MAX_BACKOFF)
+        {
+            Backoff <<= 1;
+        }
+    }
+}
+
+external void
+UnlockSpinlock(spinlock* Lock)
+{
+    AtomicStore32(&Lock->State, 0);
+}
+
+external void
+LockTicketlock(ticketlock* Lock)
+{
+    u32 Ticket = (u32)AtomicAddFetch32(&Lock->Next, 1) - 1;
+    for (;;)
+    {
+        u32 Distance = Ticket - (u32)AtomicLoad32(&Lock->Serving);
+        if (Distance == 0) break;
+        
+        // Threads further back in line have longer to wait, so they check less often.
+        for (u32 Count = 0; Count < Distance * 8; Count++)
+        {
+            CpuPause();
+        }
+    }
+}
+
+external void
+UnlockTicketlock(ticketlock* Lock)
+{
+    // Only the holder writes to [.Serving], so there's no need for a read-modify-write.
+    AtomicStore32(&Lock->Serving, (i32)(Lock->Serving + 1));
+}
+
+external void
+BeginSeqlockWrite(seqlock* Lock)
+{
+    AtomicStore32(&Lock->Seq, (i32)(Lock->Seq + 1));
+    AtomicFence(ATOMIC_RELEASE);
+}
+
+external void
+EndSeqlockWrite(seqlock* Lock)
+{
+    AtomicStore32(&Lock->Seq, (i32)(Lock->Seq + 1));
+}
+
+external u32
+BeginSeqlockRead(seqlock* Lock)
+{
+    u32 Seq = (u32)AtomicLoad32(&Lock->Seq);
+    while (Seq & 1)
+    {
+        CpuPause();
+        Seq = (u32)AtomicLoad32(&Lock->Seq);
+    }
+    return Seq;
+}
+
+external bool
+RetrySeqlockRead(seqlock* Lock, u32 Seq)
+{
+    AtomicFence(ATOMIC_ACQUIRE);
+    bool Result = ((u32)AtomicLoad32(&Lock->Seq) != Seq);
+    return Result;
+}
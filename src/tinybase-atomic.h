@@ -4,12 +4,38 @@
 //
 // Module to generalise atomic operations, which are compiler-specific.
 // These operations are meant for multithreaded code, and are guaranteed
-// to run in Aquire-Release semantics.
+// to run in Aquire-Release semantics. Each operation also has an Explicit
+// version, that takes the memory order to use as its last argument, for
+// when a weaker (or stronger) ordering is wanted.
 //==========================================================================
 #define TINYBASE_ATOMIC_H
 
 #include "tinybase-platform.h"
 
+//========================================
+// Memory Order
+//========================================
+
+#define ATOMIC_RELAXED 0
+#define ATOMIC_ACQUIRE 2
+#define ATOMIC_RELEASE 3
+#define ATOMIC_ACQ_REL 4
+#define ATOMIC_SEQ_CST 5
+
+/* Memory orders taken by the Explicit functions, with the same meaning as in C11. RELAXED
+ |  only makes the operation itself atomic, without ordering any other memory access around
+ |  it, which is enough for things like statistics counters. ACQUIRE and RELEASE are for
+ |  handing data over between threads, and SEQ_CST additionally puts all SEQ_CST operations
+ |  in a single total order. On x64, every read-modify-write operation is a full barrier
+ |  regardless, so the order mostly matters for loads, stores, fences, and for what the
+ |  compiler is allowed to reorder. */
+
+external void AtomicFence(i32 Order);
+
+/* Prevents memory accesses from being reordered across the call, according to [Order]. A
+ |  SEQ_CST fence also orders earlier stores before later loads, which the others don't.
+|--- Return: nothing. */
+
 //========================================
 // Exchange
 //========================================
@@ -39,9 +65,34 @@ external void* AtomicExchangePtr(void* volatile* Dst, void* Value);
 /* Saves pointer [Value] into [Dst] in a thread-safe manner, and returns previous value.
 |--- Result: pointer address at [Dst] before function call. */
 
+external i16 AtomicExchange16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicExchange16(), with memory order [Order].
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicExchange32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicExchange32(), with memory order [Order].
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicExchange64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicExchange64(), with memory order [Order].
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicExchangeIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicExchangeIsz(), with memory order [Order].
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external void* AtomicExchangePtrExplicit(void* volatile* Dst, void* Value, i32 Order);
+
+/* Same as AtomicExchangePtr(), with memory order [Order].
+|--- Return: pointer address at [Dst] before function call. */
+
 
 //========================================
-// Compate Exchange
+// Compare Exchange
 //========================================
 
 external bool AtomicCompareExchange16(void* volatile Dst, i16 Compare, i16 Value);
@@ -74,6 +125,45 @@ external bool AtomicCompareExchangePtr(void* volatile* Dst, void* Compare, void*
 |  [Compare] are the same. If they are different, doesn't do anything.
 |--- Return: true if successful, false if not. */
 
+external bool AtomicCompareExchange16Explicit(void* volatile Dst, i16 Compare, i16 Value, i32 Order);
+
+/* Same as AtomicCompareExchange16(), with memory order [Order]. If the exchange fails,
+ |  only the load part of [Order] applies.
+|--- Return: true if successful, false if not. */
+
+external bool AtomicCompareExchange32Explicit(void* volatile Dst, i32 Compare, i32 Value, i32 Order);
+
+/* Same as AtomicCompareExchange32(), with memory order [Order]. If the exchange fails,
+ |  only the load part of [Order] applies.
+|--- Return: true if successful, false if not. */
+
+external bool AtomicCompareExchange64Explicit(void* volatile Dst, i64 Compare, i64 Value, i32 Order);
+
+/* Same as AtomicCompareExchange64(), with memory order [Order]. If the exchange fails,
+ |  only the load part of [Order] applies.
+|--- Return: true if successful, false if not. */
+
+external bool AtomicCompareExchangeIszExplicit(void* volatile Dst, isz Compare, isz Value, i32 Order);
+
+/* Same as AtomicCompareExchangeIsz(), with memory order [Order]. If the exchange fails,
+ |  only the load part of [Order] applies.
+|--- Return: true if successful, false if not. */
+
+external bool AtomicCompareExchangePtrExplicit(void* volatile* Dst, void* Compare, void* Value, i32 Order);
+
+/* Same as AtomicCompareExchangePtr(), with memory order [Order]. If the exchange fails,
+ |  only the load part of [Order] applies.
+|--- Return: true if successful, false if not. */
+
+external bool AtomicCompareExchange128(void* volatile Dst, i64* Compare, i64 ValueLo, i64 ValueHi);
+
+/* Saves the 128-bit value made of [ValueLo] and [ValueHi] into [Dst] in a thread-safe
+ |  manner, if [Dst] holds the same 128 bits as the two-element array [Compare] (low half
+ |  first). If they are different, [Compare] is updated with the current value at [Dst],
+ |  ready for a retry. Meant for pointers paired with a counter or tag, to prevent the ABA
+ |  problem. [Dst] must be aligned to 16 bytes. Always runs in SEQ_CST order. x64 only.
+|--- Return: true if successful, false if not. */
+
 
 //========================================
 // Add and Fetch
@@ -109,6 +199,366 @@ external void* AtomicAddFetchPtr(void* volatile* Dst, isz Value);
  |  current value.
 |--- Return: pointer address at [Dst] after function call. */
 
+external i16 AtomicAddFetch16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicAddFetch16(), with memory order [Order].
+|--- Return: 16-bit value at [Dst] after function call. */
+
+external i32 AtomicAddFetch32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicAddFetch32(), with memory order [Order].
+|--- Return: 32-bit value at [Dst] after function call. */
+
+external i64 AtomicAddFetch64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicAddFetch64(), with memory order [Order].
+|--- Return: 64-bit value at [Dst] after function call. */
+
+external isz AtomicAddFetchIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicAddFetchIsz(), with memory order [Order].
+|--- Return: 32/64-bit value at [Dst] after function call. */
+
+external void* AtomicAddFetchPtrExplicit(void* volatile* Dst, isz Value, i32 Order);
+
+/* Same as AtomicAddFetchPtr(), with memory order [Order].
+|--- Return: pointer address at [Dst] after function call. */
+
+
+//========================================
+// Fetch Bitwise
+//========================================
+
+external i16 AtomicFetchOr16(void* volatile Dst, i16 Value);
+
+/* Bitwise ORs 16-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchOr32(void* volatile Dst, i32 Value);
+
+/* Bitwise ORs 32-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchOr64(void* volatile Dst, i64 Value);
+
+/* Bitwise ORs 64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchOrIsz(void* volatile Dst, isz Value);
+
+/* Bitwise ORs 32/64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external i16 AtomicFetchOr16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicFetchOr16(), with memory order [Order].
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchOr32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicFetchOr32(), with memory order [Order].
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchOr64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicFetchOr64(), with memory order [Order].
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchOrIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicFetchOrIsz(), with memory order [Order].
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external i16 AtomicFetchAnd16(void* volatile Dst, i16 Value);
+
+/* Bitwise ANDs 16-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchAnd32(void* volatile Dst, i32 Value);
+
+/* Bitwise ANDs 32-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchAnd64(void* volatile Dst, i64 Value);
+
+/* Bitwise ANDs 64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchAndIsz(void* volatile Dst, isz Value);
+
+/* Bitwise ANDs 32/64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external i16 AtomicFetchAnd16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicFetchAnd16(), with memory order [Order].
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchAnd32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicFetchAnd32(), with memory order [Order].
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchAnd64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicFetchAnd64(), with memory order [Order].
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchAndIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicFetchAndIsz(), with memory order [Order].
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external i16 AtomicFetchXor16(void* volatile Dst, i16 Value);
+
+/* Bitwise XORs 16-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchXor32(void* volatile Dst, i32 Value);
+
+/* Bitwise XORs 32-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchXor64(void* volatile Dst, i64 Value);
+
+/* Bitwise XORs 64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchXorIsz(void* volatile Dst, isz Value);
+
+/* Bitwise XORs 32/64-bit [Value] with the content of [Dst] in a thread-safe manner, and
+ |  returns the previous value.
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+external i16 AtomicFetchXor16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicFetchXor16(), with memory order [Order].
+|--- Return: 16-bit value at [Dst] before function call. */
+
+external i32 AtomicFetchXor32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicFetchXor32(), with memory order [Order].
+|--- Return: 32-bit value at [Dst] before function call. */
+
+external i64 AtomicFetchXor64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicFetchXor64(), with memory order [Order].
+|--- Return: 64-bit value at [Dst] before function call. */
+
+external isz AtomicFetchXorIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicFetchXorIsz(), with memory order [Order].
+|--- Return: 32/64-bit value at [Dst] before function call. */
+
+
+//========================================
+// Load and Store
+//========================================
+
+external i16 AtomicLoad16(void* volatile Src);
+
+/* Reads 16-bit value from [Src] in a thread-safe manner, with Acquire semantics.
+|--- Return: 16-bit value at [Src]. */
+
+external i32 AtomicLoad32(void* volatile Src);
+
+/* Reads 32-bit value from [Src] in a thread-safe manner, with Acquire semantics.
+|--- Return: 32-bit value at [Src]. */
+
+external i64 AtomicLoad64(void* volatile Src);
+
+/* Reads 64-bit value from [Src] in a thread-safe manner, with Acquire semantics.
+|--- Return: 64-bit value at [Src]. */
+
+external isz AtomicLoadIsz(void* volatile Src);
+
+/* Reads 32/64-bit value from [Src] in a thread-safe manner, with Acquire semantics.
+|--- Return: 32/64-bit value at [Src]. */
+
+external void* AtomicLoadPtr(void* volatile* Src);
+
+/* Reads pointer from [Src] in a thread-safe manner, with Acquire semantics.
+|--- Return: pointer address at [Src]. */
+
+external void AtomicStore16(void* volatile Dst, i16 Value);
+
+/* Saves 16-bit [Value] into [Dst] in a thread-safe manner, with Release semantics.
+|--- Return: nothing. */
+
+external void AtomicStore32(void* volatile Dst, i32 Value);
+
+/* Saves 32-bit [Value] into [Dst] in a thread-safe manner, with Release semantics.
+|--- Return: nothing. */
+
+external void AtomicStore64(void* volatile Dst, i64 Value);
+
+/* Saves 64-bit [Value] into [Dst] in a thread-safe manner, with Release semantics.
+|--- Return: nothing. */
+
+external void AtomicStoreIsz(void* volatile Dst, isz Value);
+
+/* Saves 32/64-bit [Value] into [Dst] in a thread-safe manner, with Release semantics.
+|--- Return: nothing. */
+
+external void AtomicStorePtr(void* volatile* Dst, void* Value);
+
+/* Saves pointer [Value] into [Dst] in a thread-safe manner, with Release semantics.
+|--- Return: nothing. */
+
+external i16 AtomicLoad16Explicit(void* volatile Src, i32 Order);
+
+/* Same as AtomicLoad16(), with memory order [Order]. RELEASE and ACQ_REL act as ACQUIRE.
+|--- Return: 16-bit value at [Src]. */
+
+external i32 AtomicLoad32Explicit(void* volatile Src, i32 Order);
+
+/* Same as AtomicLoad32(), with memory order [Order]. RELEASE and ACQ_REL act as ACQUIRE.
+|--- Return: 32-bit value at [Src]. */
+
+external i64 AtomicLoad64Explicit(void* volatile Src, i32 Order);
+
+/* Same as AtomicLoad64(), with memory order [Order]. RELEASE and ACQ_REL act as ACQUIRE.
+|--- Return: 64-bit value at [Src]. */
+
+external isz AtomicLoadIszExplicit(void* volatile Src, i32 Order);
+
+/* Same as AtomicLoadIsz(), with memory order [Order]. RELEASE and ACQ_REL act as ACQUIRE.
+|--- Return: 32/64-bit value at [Src]. */
+
+external void* AtomicLoadPtrExplicit(void* volatile* Src, i32 Order);
+
+/* Same as AtomicLoadPtr(), with memory order [Order]. RELEASE and ACQ_REL act as ACQUIRE.
+|--- Return: pointer address at [Src]. */
+
+external void AtomicStore16Explicit(void* volatile Dst, i16 Value, i32 Order);
+
+/* Same as AtomicStore16(), with memory order [Order]. ACQUIRE and ACQ_REL act as RELEASE.
+|--- Return: nothing. */
+
+external void AtomicStore32Explicit(void* volatile Dst, i32 Value, i32 Order);
+
+/* Same as AtomicStore32(), with memory order [Order]. ACQUIRE and ACQ_REL act as RELEASE.
+|--- Return: nothing. */
+
+external void AtomicStore64Explicit(void* volatile Dst, i64 Value, i32 Order);
+
+/* Same as AtomicStore64(), with memory order [Order]. ACQUIRE and ACQ_REL act as RELEASE.
+|--- Return: nothing. */
+
+external void AtomicStoreIszExplicit(void* volatile Dst, isz Value, i32 Order);
+
+/* Same as AtomicStoreIsz(), with memory order [Order]. ACQUIRE and ACQ_REL act as RELEASE.
+|--- Return: nothing. */
+
+external void AtomicStorePtrExplicit(void* volatile* Dst, void* Value, i32 Order);
+
+/* Same as AtomicStorePtr(), with memory order [Order]. ACQUIRE and ACQ_REL act as RELEASE.
+|--- Return: nothing. */
+
+
+//========================================
+// Locks
+//========================================
+
+typedef struct spinlock
+{
+    i32 State;
+} spinlock;
+
+/* Test-and-test-and-set lock, that never puts the thread to sleep. Threads waiting on it
+ |  only read [.State] until it looks free, and back off exponentially with pause between
+ |  attempts, so they don't keep the cache line bouncing between cores. Only meant for very
+ |  short critical sections. Zero-initialize it before use. */
+
+external void LockSpinlock(spinlock* Lock);
+
+/* Acquires [Lock], spinning until it is released if another thread holds it.
+|--- Return: nothing. */
+
+external bool TryLockSpinlock(spinlock* Lock);
+
+/* Tries to acquire [Lock] once, without spinning.
+|--- Return: true if lock was acquired, false if it is held by another thread. */
+
+external void UnlockSpinlock(spinlock* Lock);
+
+/* Releases [Lock].
+|--- Return: nothing. */
+
+
+typedef struct ticketlock
+{
+    u32 Next;
+    u32 Serving;
+} ticketlock;
+
+/* Fair spinning lock. Each thread takes a ticket from [.Next], and waits until [.Serving]
+ |  gets to it, so the lock is handed over in the order it was requested. Waiting threads
+ |  pause for longer the further back in line they are. Zero-initialize it before use. */
+
+external void LockTicketlock(ticketlock* Lock);
+
+/* Takes a ticket and spins until it is [Lock]'s turn.
+|--- Return: nothing. */
+
+external void UnlockTicketlock(ticketlock* Lock);
+
+/* Releases [Lock], passing it to the next thread in line.
+|--- Return: nothing. */
+
+
+typedef struct seqlock
+{
+    u32 Seq;
+} seqlock;
+
+/* Lock for data with a single writer and many readers. The writer makes [.Seq] odd while
+ |  it's writing, and readers copy the data out and check that [.Seq] didn't change in the
+ |  meantime, trying again if it did. Readers never write to shared memory, so they don't
+ |  invalidate each other's caches. Zero-initialize it before use. Usage:
+|
+|  u32 Seq;
+|  do
+|  {
+|      Seq = BeginSeqlockRead(&Lock);
+|      Copy = SharedData;
+|  } while (RetrySeqlockRead(&Lock, Seq));
+|
+|  The data read inside the loop may be torn, so it must only be used after the loop. */
+
+external void BeginSeqlockWrite(seqlock* Lock);
+
+/* Starts a write to the data protected by [Lock]. There must only be one writer at a time;
+ |  guard it with another lock if there are more.
+|--- Return: nothing. */
+
+external void EndSeqlockWrite(seqlock* Lock);
+
+/* Ends a write started with BeginSeqlockWrite().
+|--- Return: nothing. */
+
+external u32 BeginSeqlockRead(seqlock* Lock);
+
+/* Starts a read of the data protected by [Lock], waiting while a write is in progress.
+|--- Return: sequence number to pass to RetrySeqlockRead(). */
+
+external bool RetrySeqlockRead(seqlock* Lock, u32 Seq);
+
+/* Checks if the data protected by [Lock] was written to since BeginSeqlockRead() returned
+ |  [Seq].
+|--- Return: true if the read must be retried, false if the data read is consistent. */
+
 
 #if !defined(TT_STATIC_LINKING)
 #include "tinybase-atomic.c"
@@ -0,0 +1,235 @@
+//========================================
+// Jobs
+//========================================
+
+global thread_local job_worker* _tJobWorker = NULL;
+
+external void
+InitJob(job* Job, job_proc Proc, void* Arg, job* Parent)
+{
+    Job->Proc = Proc;
+    Job->Arg = Arg;
+    Job->Parent = Parent;
+    Job->Unfinished = 1;
+    if (Parent)
+    {
+        // Nothing is published by taking a count, only by dropping it.
+        AtomicAddFetch32Explicit(&Parent->Unfinished, 1, ATOMIC_RELAXED);
+    }
+}
+
+external bool
+IsJobDone(job* Job)
+{
+    bool Result = (AtomicLoad32(&Job->Unfinished) == 0);
+    return Result;
+}
+
+internal void
+_ExecuteJob(job* Job)
+{
+    if (Job->Proc)
+    {
+        Job->Proc(Job->Arg);
+    }
+    
+    // Walks up the tree for as long as each job was the last one its parent waited on. The
+    // parent is read first, since a job can be freed by its waiter as soon as it is done.
+    while (Job)
+    {
+        job* Parent = Job->Parent;
+        if (AtomicAddFetch32(&Job->Unfinished, -1) != 0) break;
+        Job = Parent;
+    }
+}
+
+
+//========================================
+// Job System
+//========================================
+
+#define JOB_SPIN_COUNT 64
+
+internal job*
+_StealJob(job_system* System, job_worker* Thief)
+{
+    // Xorshift, so each thief starts at a different victim.
+    u32 Random = (Thief) ? Thief->Random : (u32)(usz)&Random;
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    if (Thief) Thief->Random = Random;
+    
+    for (usz Count = 0; Count < System->NumWorkers; Count++)
+    {
+        job_worker* Victim = &System->Workers[(Random + Count) % System->NumWorkers];
+        if (Victim != Thief)
+        {
+            job* Job = (job*)WSDequeSteal(&Victim->Queue);
+            if (Job) return Job;
+        }
+    }
+    return NULL;
+}
+
+internal job*
+_GetJob(job_system* System, job_worker* Worker)
+{
+    job* Job = NULL;
+    if (Worker && Worker->System == System)
+    {
+        Job = (job*)WSDequePop(&Worker->Queue);
+    }
+    if (!Job)
+    {
+        Job = _StealJob(System, Worker);
+    }
+    return Job;
+}
+
+internal THREAD_PROC(_JobWorkerProc)
+{
+    job_worker* Worker = (job_worker*)Arg;
+    job_system* System = Worker->System;
+    _tJobWorker = Worker;
+    
+    while (AtomicLoad32(&System->Running))
+    {
+        job* Job = NULL;
+        for (i32 Spin = 0; !Job && Spin < JOB_SPIN_COUNT; Spin++)
+        {
+            Job = _GetJob(System, Worker);
+            if (!Job) CpuPause();
+        }
+        
+        if (!Job)
+        {
+            // Announces itself before the last check, so a job pushed after it will see the
+            // sleeper and post to the semaphore.
+            AtomicAddFetch32(&System->Sleepers, 1);
+            Job = _GetJob(System, Worker);
+            if (!Job && AtomicLoad32(&System->Running))
+            {
+                WaitOnSemaphore(&System->Wakeup);
+            }
+            AtomicAddFetch32(&System->Sleepers, -1);
+        }
+        
+        if (Job)
+        {
+            _ExecuteJob(Job);
+        }
+    }
+    
+    _tJobWorker = NULL;
+    return 0;
+}
+
+external bool
+InitJobSystem(job_system* System, buffer* Arena, usz QueueSize)
+{
+    usz NumWorkers = Max(gSysInfo.NumThreads, 1);
+    usz QueueBytes = QueueSize * sizeof(void*);
+    
+    job_worker* Workers = PushArray(Arena, NumWorkers, job_worker);
+    if (!Workers) return false;
+    
+    System->Workers = Workers;
+    System->NumWorkers = NumWorkers;
+    System->Running = 1;
+    System->Sleepers = 0;
+    System->Wakeup = InitSemaphore(0);
+    
+    for (usz Idx = 0; Idx < NumWorkers; Idx++)
+    {
+        job_worker* Worker = &Workers[Idx];
+        void* QueueBuf = PushIntoArena(Arena, QueueBytes);
+        if (!InitWSDeque(&Worker->Queue, QueueBuf, QueueBytes))
+        {
+            CloseSemaphore(&System->Wakeup);
+            return false;
+        }
+        Worker->System = System;
+        Worker->Thread.Handle = 0;
+        Worker->Random = (u32)(Idx + 1) * 0x9E3779B9;
+    }
+    
+    _tJobWorker = &Workers[0];
+    for (usz Idx = 1; Idx < NumWorkers; Idx++)
+    {
+        Workers[Idx].Thread = InitThread(_JobWorkerProc, &Workers[Idx], true);
+        if (!Workers[Idx].Thread.Handle)
+        {
+            CloseJobSystem(System);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+external void
+CloseJobSystem(job_system* System)
+{
+    AtomicStore32(&System->Running, 0);
+    for (usz Idx = 1; Idx < System->NumWorkers; Idx++)
+    {
+        IncreaseSemaphore(&System->Wakeup);
+    }
+    for (usz Idx = 1; Idx < System->NumWorkers; Idx++)
+    {
+        if (System->Workers[Idx].Thread.Handle)
+        {
+            WaitOnThread(&System->Workers[Idx].Thread);
+        }
+    }
+    CloseSemaphore(&System->Wakeup);
+    
+    if (_tJobWorker == &System->Workers[0])
+    {
+        _tJobWorker = NULL;
+    }
+}
+
+external bool
+RunJob(job_system* System, job* Job)
+{
+    job_worker* Worker = _tJobWorker;
+    if (!Worker || Worker->System != System)
+    {
+        return false;
+    }
+    
+    if (WSDequePush(&Worker->Queue, Job))
+    {
+        // The add of zero acts as a full barrier between the push and reading the sleeper
+        // count, matching the one sleeping workers do before their last check.
+        if (AtomicAddFetch32(&System->Sleepers, 0) > 0)
+        {
+            IncreaseSemaphore(&System->Wakeup);
+        }
+    }
+    else
+    {
+        _ExecuteJob(Job);
+    }
+    return true;
+}
+
+external void
+WaitOnJob(job_system* System, job* Job)
+{
+    job_worker* Worker = _tJobWorker;
+    while (!IsJobDone(Job))
+    {
+        job* Other = _GetJob(System, Worker);
+        if (Other)
+        {
+            _ExecuteJob(Other);
+        }
+        else
+        {
+            CpuPause();
+        }
+    }
+}
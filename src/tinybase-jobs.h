@@ -0,0 +1,111 @@
+#ifndef TINYBASE_JOBS_H
+//=========================================================================
+// tinybase-jobs.h
+//
+// Module for spreading work over a pool of threads. Each thread owns a
+// work-stealing deque where it pushes the jobs it creates, and idle
+// threads steal jobs from the others, so there is no global queue for
+// all of them to contend on. Jobs can have a parent, which is only done
+// once all its children are done.
+//=========================================================================
+#define TINYBASE_JOBS_H
+
+#include "tinybase-types.h"
+#include "tinybase-platform.h"
+#include "tinybase-queues.h"
+
+
+//========================================
+// Jobs
+//========================================
+
+#define JOB_PROC(Name) void Name(void* Arg)
+typedef void (*job_proc)(void*);
+
+typedef struct job
+{
+    job_proc Proc;
+    void* Arg;
+    struct job* Parent;
+    i32 Unfinished;
+} job;
+
+/* A unit of work. [.Proc] is called with [.Arg] by whichever thread runs the job, and
+ |  [.Unfinished] counts the job itself plus all of its children that have not finished yet.
+ |  The memory for the job is owned by the application, and must remain valid until the job
+ |  is done. */
+
+external void InitJob(job* Job, job_proc Proc, void* Arg, _opt job* Parent);
+
+/* Sets up [Job] to call [Proc] with [Arg]. [Proc] can be NULL, in which case the job only
+ |  serves to group its children. If [Parent] is passed, it will only be done after [Job] is
+ |  done; [Parent] must not have finished yet when this is called (e.g. call this from inside
+ |  the parent's [.Proc], or before running the parent).
+ |--- Return: nothing. */
+
+external bool IsJobDone(job* Job);
+
+/* Checks if [Job] and all of its children have finished running.
+ |--- Return: true if done, false if not. */
+
+
+//========================================
+// Job System
+//========================================
+
+typedef struct job_worker
+{
+    ws_deque Queue;
+    struct job_system* System;
+    thread Thread;
+    u32 Random;
+} job_worker;
+
+typedef struct job_system
+{
+    job_worker* Workers;
+    usz NumWorkers;
+    i32 Running;
+    i32 Sleepers;
+    semaphore Wakeup;
+} job_system;
+
+/* Structure holding the pool of threads. [.Workers] has one entry per thread that runs
+ |  jobs; entry zero belongs to the thread that called InitJobSystem(), which runs jobs while
+ |  it waits on them. Workers that find no job to run or steal spin for a short while, and
+ |  then sleep on [.Wakeup] until new jobs are pushed. */
+
+external bool InitJobSystem(job_system* System, buffer* Arena, usz QueueSize);
+
+/* Sets up [System] and spawns gSysInfo.NumThreads-1 worker threads, so that together with
+ |  the calling thread there's one thread per core. The workers and their deques are pushed
+ |  into [Arena], with room for [QueueSize] pending jobs in each deque. LoadSystemInfo() must
+ |  have been called first.
+ |--- Return: true if successful, false if [Arena] ran out of space or a thread failed to
+ |            start. */
+
+external void CloseJobSystem(job_system* System);
+
+/* Stops all worker threads and waits for them to exit. Jobs still pending are not run.
+ |  Must be called from the same thread that called InitJobSystem().
+ |--- Return: nothing. */
+
+external bool RunJob(job_system* System, job* Job);
+
+/* Schedules [Job] to run on [System]. Must be called from the thread that initialized the
+ |  system, or from inside a job. If the calling thread's deque is full, [Job] is run
+ |  immediately instead.
+ |--- Return: true if successful, false if called from another thread. */
+
+external void WaitOnJob(job_system* System, job* Job);
+
+/* Blocks until [Job] and all of its children are done. Instead of sleeping, the calling
+ |  thread runs other pending jobs in the meantime, including ones stolen from other threads.
+ |--- Return: nothing. */
+
+
+#if !defined(TT_STATIC_LINKING)
+#include "tinybase-jobs.c"
+#endif
+
+#endif //TINYBASE_JOBS_H
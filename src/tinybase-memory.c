@@ -447,6 +447,304 @@ PushIntoArena(buffer* Arena, usz Size)
     return Result;
 }
 
+external void*
+PushIntoArenaAligned(buffer* Arena, usz Size, usz Alignment)
+{
+    void* Result = NULL;
+    usz Address = (usz)Arena->Base + Arena->WriteCur;
+    usz Padding = (Align(Address, Alignment)) - Address;
+    if (Arena->WriteCur + Padding + Size <= Arena->Size)
+    {
+        Result = (u8*)Arena->Base + Arena->WriteCur + Padding;
+        Arena->WriteCur += Padding + Size;
+    }
+    return Result;
+}
+
+external arena_temp
+ArenaBeginTemp(buffer* Arena)
+{
+    arena_temp Result = { Arena, Arena->WriteCur };
+    return Result;
+}
+
+external void
+ArenaEndTemp(arena_temp Temp)
+{
+    Temp.Arena->WriteCur = Temp.WriteCur;
+}
+
+//==================================
+// Pool
+//==================================
+
+external void
+InitPool(pool* Pool, void* Buf, usz BufSize, usz ObjectSize)
+{
+    Pool->Arena = Buffer(Buf, 0, BufSize);
+    Pool->ObjectSize = (ObjectSize > sizeof(void*)) ? Align(ObjectSize, sizeof(void*)) : sizeof(void*);
+    Pool->FreeList = NULL;
+}
+
+external void*
+PoolAlloc(pool* Pool)
+{
+    void* Result = Pool->FreeList;
+    if (Result)
+    {
+        Pool->FreeList = *(void**)Result;
+    }
+    else
+    {
+        Result = PushIntoArena(&Pool->Arena, Pool->ObjectSize);
+    }
+    return Result;
+}
+
+external void
+PoolFree(pool* Pool, void* Ptr)
+{
+    *(void**)Ptr = Pool->FreeList;
+    Pool->FreeList = Ptr;
+}
+
+//==================================
+// TLSF
+//==================================
+
+#define TLSF_FREE      0x1
+#define TLSF_PREV_FREE 0x2
+#define TLSF_HEADER_SIZE (2 * sizeof(usz))
+#define TLSF_MIN_SIZE (sizeof(tlsf_block) - TLSF_HEADER_SIZE)
+
+#define _TLSFSize(Block) ((Block)->Size & ~(usz)(TLSF_FREE|TLSF_PREV_FREE))
+#define _TLSFPayload(Block) ((u8*)(Block) + TLSF_HEADER_SIZE)
+#define _TLSFFromPayload(Ptr) ((tlsf_block*)((u8*)(Ptr) - TLSF_HEADER_SIZE))
+#define _TLSFNextPhys(Block) ((tlsf_block*)(_TLSFPayload(Block) + _TLSFSize(Block)))
+
+internal void
+_TLSFMapping(usz Size, i32* Fl, i32* Sl)
+{
+    if (Size < TLSF_SMALL_SIZE)
+    {
+        *Fl = 0;
+        *Sl = (i32)(Size / (TLSF_SMALL_SIZE / TLSF_SL_COUNT));
+    }
+    else
+    {
+        i32 Last = GetLastBitSet(Size);
+        *Sl = (i32)(Size >> (Last - TLSF_SL_SHIFT)) ^ TLSF_SL_COUNT;
+        *Fl = Last - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+internal void
+_TLSFInsert(tlsf* Allocator, tlsf_block* Block)
+{
+    i32 Fl, Sl;
+    _TLSFMapping(_TLSFSize(Block), &Fl, &Sl);
+    tlsf_block* Head = Allocator->Blocks[Fl][Sl];
+    Block->NextFree = Head;
+    Block->PrevFree = NULL;
+    if (Head) Head->PrevFree = Block;
+    Allocator->Blocks[Fl][Sl] = Block;
+    Allocator->FlBitmap |= 1U << Fl;
+    Allocator->SlBitmap[Fl] |= 1U << Sl;
+}
+
+internal void
+_TLSFRemove(tlsf* Allocator, tlsf_block* Block)
+{
+    i32 Fl, Sl;
+    _TLSFMapping(_TLSFSize(Block), &Fl, &Sl);
+    if (Block->NextFree) Block->NextFree->PrevFree = Block->PrevFree;
+    if (Block->PrevFree) Block->PrevFree->NextFree = Block->NextFree;
+    else
+    {
+        Allocator->Blocks[Fl][Sl] = Block->NextFree;
+        if (!Block->NextFree)
+        {
+            Allocator->SlBitmap[Fl] &= ~(1U << Sl);
+            if (!Allocator->SlBitmap[Fl]) Allocator->FlBitmap &= ~(1U << Fl);
+        }
+    }
+}
+
+internal usz
+_TLSFRoundUp(usz Size)
+{
+    // Rounds the size up to where the next list starts, so that any block in it fits.
+    if (Size >= TLSF_SMALL_SIZE)
+    {
+        Size += ((usz)1 << (GetLastBitSet(Size) - TLSF_SL_SHIFT)) - 1;
+    }
+    return Size;
+}
+
+internal tlsf_block*
+_TLSFFindFree(tlsf* Allocator, usz Size)
+{
+    i32 Fl, Sl;
+    _TLSFMapping(Size, &Fl, &Sl);
+    if (Fl >= TLSF_FL_COUNT) return NULL;
+    
+    u32 SlMap = Allocator->SlBitmap[Fl] & (~0U << Sl);
+    if (!SlMap)
+    {
+        u32 FlMap = (Fl+1 < 32) ? Allocator->FlBitmap & (~0U << (Fl+1)) : 0;
+        if (!FlMap) return NULL;
+        Fl = GetFirstBitSet(FlMap);
+        SlMap = Allocator->SlBitmap[Fl];
+    }
+    Sl = GetFirstBitSet(SlMap);
+    return Allocator->Blocks[Fl][Sl];
+}
+
+internal tlsf_block*
+_TLSFMergeNext(tlsf* Allocator, tlsf_block* Block)
+{
+    tlsf_block* Next = _TLSFNextPhys(Block);
+    if (Next->Size & TLSF_FREE)
+    {
+        _TLSFRemove(Allocator, Next);
+        Block->Size += _TLSFSize(Next) + TLSF_HEADER_SIZE;
+        _TLSFNextPhys(Block)->PrevPhys = Block;
+    }
+    return Block;
+}
+
+internal void
+_TLSFTrim(tlsf* Allocator, tlsf_block* Block, usz Size)
+{
+    // Splits off the tail of a used block, if it is big enough to be a block of its own.
+    if (_TLSFSize(Block) >= Size + TLSF_HEADER_SIZE + TLSF_MIN_SIZE)
+    {
+        tlsf_block* Rest = (tlsf_block*)(_TLSFPayload(Block) + Size);
+        Rest->Size = (_TLSFSize(Block) - Size - TLSF_HEADER_SIZE) | TLSF_FREE;
+        Rest->PrevPhys = Block;
+        Block->Size = Size | (Block->Size & TLSF_PREV_FREE);
+        _TLSFNextPhys(Rest)->PrevPhys = Rest;
+        
+        Rest = _TLSFMergeNext(Allocator, Rest);
+        _TLSFNextPhys(Rest)->Size |= TLSF_PREV_FREE;
+        _TLSFInsert(Allocator, Rest);
+    }
+}
+
+internal usz
+_TLSFAdjustSize(usz Size)
+{
+    usz Result = (Size < TLSF_MIN_SIZE) ? TLSF_MIN_SIZE : Align(Size, TLSF_ALIGN);
+    return Result;
+}
+
+external void
+InitTLSF(tlsf* Allocator, tlsf_grow_proc Grow, void* GrowArg)
+{
+    memset(Allocator, 0, sizeof(tlsf));
+    Allocator->Grow = Grow;
+    Allocator->GrowArg = GrowArg;
+}
+
+external bool
+AddTLSFRegion(tlsf* Allocator, void* Buf, usz BufSize)
+{
+    usz Start = Align((usz)Buf, TLSF_ALIGN);
+    usz End = ((usz)Buf + BufSize) & ~(usz)(TLSF_ALIGN-1);
+    if (End <= Start || End - Start < TLSF_REGION_OVERHEAD
+        || End - Start - TLSF_REGION_OVERHEAD >= TLSF_MAX_SIZE)
+    {
+        return false;
+    }
+    
+    // The region ends in an empty used block, so the last real block never merges past it.
+    tlsf_block* Block = (tlsf_block*)Start;
+    Block->PrevPhys = NULL;
+    Block->Size = (End - Start - 2*TLSF_HEADER_SIZE) | TLSF_FREE;
+    tlsf_block* Sentinel = _TLSFNextPhys(Block);
+    Sentinel->PrevPhys = Block;
+    Sentinel->Size = TLSF_PREV_FREE;
+    _TLSFInsert(Allocator, Block);
+    return true;
+}
+
+external void*
+TLSFAlloc(tlsf* Allocator, usz Size)
+{
+    if (Size >= TLSF_MAX_SIZE) return NULL;
+    Size = _TLSFAdjustSize(Size);
+    
+    usz SearchSize = _TLSFRoundUp(Size);
+    tlsf_block* Block = _TLSFFindFree(Allocator, SearchSize);
+    if (!Block && Allocator->Grow
+        && Allocator->Grow(Allocator, SearchSize, Allocator->GrowArg))
+    {
+        Block = _TLSFFindFree(Allocator, SearchSize);
+    }
+    if (!Block) return NULL;
+    
+    _TLSFRemove(Allocator, Block);
+    Block->Size &= ~(usz)TLSF_FREE;
+    _TLSFNextPhys(Block)->Size &= ~(usz)TLSF_PREV_FREE;
+    _TLSFTrim(Allocator, Block, Size);
+    return _TLSFPayload(Block);
+}
+
+external void
+TLSFFree(tlsf* Allocator, void* Ptr)
+{
+    if (!Ptr) return;
+    
+    tlsf_block* Block = _TLSFFromPayload(Ptr);
+    Block->Size |= TLSF_FREE;
+    if (Block->Size & TLSF_PREV_FREE)
+    {
+        tlsf_block* Prev = Block->PrevPhys;
+        _TLSFRemove(Allocator, Prev);
+        Prev->Size += _TLSFSize(Block) + TLSF_HEADER_SIZE;
+        _TLSFNextPhys(Prev)->PrevPhys = Prev;
+        Block = Prev;
+    }
+    Block = _TLSFMergeNext(Allocator, Block);
+    _TLSFNextPhys(Block)->Size |= TLSF_PREV_FREE;
+    _TLSFInsert(Allocator, Block);
+}
+
+external void*
+TLSFRealloc(tlsf* Allocator, void* Ptr, usz Size)
+{
+    if (!Ptr) return TLSFAlloc(Allocator, Size);
+    if (!Size)
+    {
+        TLSFFree(Allocator, Ptr);
+        return NULL;
+    }
+    if (Size >= TLSF_MAX_SIZE) return NULL;
+    
+    tlsf_block* Block = _TLSFFromPayload(Ptr);
+    usz OldSize = _TLSFSize(Block);
+    usz NewSize = _TLSFAdjustSize(Size);
+    tlsf_block* Next = _TLSFNextPhys(Block);
+    if (NewSize > OldSize)
+    {
+        if (!(Next->Size & TLSF_FREE)
+            || OldSize + TLSF_HEADER_SIZE + _TLSFSize(Next) < NewSize)
+        {
+            void* Result = TLSFAlloc(Allocator, Size);
+            if (Result)
+            {
+                memcpy(Result, Ptr, OldSize);
+                TLSFFree(Allocator, Ptr);
+            }
+            return Result;
+        }
+        _TLSFMergeNext(Allocator, Block);
+        _TLSFNextPhys(Block)->Size &= ~(usz)TLSF_PREV_FREE;
+    }
+    _TLSFTrim(Allocator, Block, NewSize);
+    return Ptr;
+}
+
 //==================================
 // Architecture-dependent code
 //==================================
@@ -145,6 +145,8 @@ external bool EqualBuffers(buffer A, buffer B);
 #define PushSize(Arena, Size, Type) (Type*)PushIntoArena(Arena, Size)
 #define PushStruct(Arena, Type) (Type*)PushIntoArena(Arena, sizeof(Type))
 #define PushArray(Arena, Count, Type) (Type*)PushIntoArena(Arena, Count * sizeof(Type))
+#define PushStructAligned(Arena, Type, Alignment) (Type*)PushIntoArenaAligned(Arena, sizeof(Type), Alignment)
+#define PushArrayAligned(Arena, Count, Type, Alignment) (Type*)PushIntoArenaAligned(Arena, Count * sizeof(Type), Alignment)
 
 external void* PushIntoArena(buffer* Arena, usz Size);
 
@@ -152,6 +154,146 @@ external void* PushIntoArena(buffer* Arena, usz Size);
 |  accordingly, if new region fits in buffer.
 |--- Return: pointer to the beginning of region if successful, NULL if not. */
 
+external void* PushIntoArenaAligned(buffer* Arena, usz Size, usz Alignment);
+
+/* Same as PushIntoArena(), but the region starts at an address that is a multiple of
+|  [Alignment], which must be a power of two. The bytes skipped to get there are lost.
+|--- Return: pointer to the beginning of region if successful, NULL if not. */
+
+typedef struct arena_temp
+{
+    buffer* Arena;
+    usz WriteCur;
+} arena_temp;
+
+/* Marker of the state of an arena at some point, so that everything pushed into it after
+|  that can be dropped at once. */
+
+external arena_temp ArenaBeginTemp(buffer* Arena);
+
+/* Saves the current [.WriteCur] of [Arena]. Markers can be nested, as long as they are
+|  ended in reverse order.
+|--- Return: marker to be passed to ArenaEndTemp(). */
+
+external void ArenaEndTemp(arena_temp Temp);
+
+/* Rolls back the arena in [Temp] to the point where the marker was taken, freeing every
+|  region pushed since then. Does not touch the memory itself.
+|--- Return: nothing. */
+
+
+
+//=================================
+// Pool
+//=================================
+
+typedef struct pool
+{
+    buffer Arena;
+    usz ObjectSize;
+    void* FreeList;
+} pool;
+
+/* Allocator for objects of a single size. Objects are carved out of [.Arena] as needed, and
+|  freed ones are kept in [.FreeList], linked through their own first bytes, to be handed out
+|  again before carving new ones. Both operations are O(1). */
+
+external void InitPool(pool* Pool, void* Buf, usz BufSize, usz ObjectSize);
+
+/* Sets up [Pool] to hand out objects of [ObjectSize] bytes from the [BufSize] bytes of [Buf].
+|  [ObjectSize] is rounded up to a multiple of the pointer size, so objects are aligned to at
+|  least that if [Buf] is.
+|--- Return: nothing. */
+
+external void* PoolAlloc(pool* Pool);
+
+/* Gets an object from [Pool]. Its contents are undefined.
+|--- Return: pointer to the object if successful, NULL if the pool is exhausted. */
+
+external void PoolFree(pool* Pool, void* Ptr);
+
+/* Gives the object at [Ptr] back to [Pool]. [Ptr] must have come from PoolAlloc() on the
+|  same pool.
+|--- Return: nothing. */
+
+
+
+//=================================
+// TLSF
+//=================================
+
+#define TLSF_ALIGN_SHIFT 4
+#define TLSF_ALIGN (1 << TLSF_ALIGN_SHIFT)
+#define TLSF_SL_SHIFT 5
+#define TLSF_SL_COUNT (1 << TLSF_SL_SHIFT)
+#define TLSF_FL_SHIFT (TLSF_SL_SHIFT + TLSF_ALIGN_SHIFT)
+#define TLSF_FL_MAX 38
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_SMALL_SIZE (1 << TLSF_FL_SHIFT)
+#define TLSF_MAX_SIZE ((usz)1 << TLSF_FL_MAX)
+#define TLSF_REGION_OVERHEAD (3 * TLSF_ALIGN)
+
+typedef struct tlsf_block
+{
+    struct tlsf_block* PrevPhys;
+    usz Size;
+    struct tlsf_block* NextFree;
+    struct tlsf_block* PrevFree;
+} tlsf_block;
+
+struct tlsf;
+#define TLSF_GROW_PROC(Name) bool Name(struct tlsf* Allocator, usz MinSize, void* Arg)
+typedef bool (*tlsf_grow_proc)(struct tlsf*, usz, void*);
+
+typedef struct tlsf
+{
+    u32 FlBitmap;
+    u32 SlBitmap[TLSF_FL_COUNT];
+    tlsf_block* Blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    tlsf_grow_proc Grow;
+    void* GrowArg;
+} tlsf;
+
+/* Two-Level Segregated Fit allocator. Free blocks are kept in lists indexed by the most
+|  significant bit of their size ([.FlBitmap]) and by the next TLSF_SL_SHIFT bits under it
+|  ([.SlBitmap]), so finding a block that fits is a couple of bit scans, and allocating,
+|  freeing and resizing are all O(1). Freed blocks are merged with their free neighbours
+|  right away. Each block has a 16-byte header, and is aligned to TLSF_ALIGN bytes.
+|  Not thread-safe; use one allocator per thread, or guard it with a lock. */
+
+external void InitTLSF(tlsf* Allocator, _opt tlsf_grow_proc Grow, _opt void* GrowArg);
+
+/* Sets up [Allocator] with no memory in it. If [Grow] is passed, it is called with [GrowArg]
+|  whenever no free block fits a request, and must add a region of at least [MinSize] plus
+|  TLSF_REGION_OVERHEAD bytes with AddTLSFRegion(), returning false if it could not.
+|--- Return: nothing. */
+
+external bool AddTLSFRegion(tlsf* Allocator, void* Buf, usz BufSize);
+
+/* Hands the [BufSize] bytes of [Buf] to [Allocator], as one free block. TLSF_REGION_OVERHEAD
+|  bytes of the region are used for bookkeeping. The region must remain valid for as long as
+|  the allocator is in use, and cannot be taken back.
+|--- Return: true if successful, false if the region is too small or too big. */
+
+external void* TLSFAlloc(tlsf* Allocator, usz Size);
+
+/* Gets a region of at least [Size] bytes from [Allocator]. Its contents are undefined.
+|--- Return: pointer to the region if successful, NULL if no free block fits it and the
+|            allocator could not grow. */
+
+external void TLSFFree(tlsf* Allocator, void* Ptr);
+
+/* Gives the region at [Ptr] back to [Allocator]. [Ptr] can be NULL.
+|--- Return: nothing. */
+
+external void* TLSFRealloc(tlsf* Allocator, void* Ptr, usz Size);
+
+/* Resizes the region at [Ptr] to [Size] bytes, in place if it can (i.e. shrinking it, or
+|  growing it into a free neighbour), or else moving its contents to a new region. If [Ptr]
+|  is NULL, same as TLSFAlloc(); if [Size] is zero, same as TLSFFree().
+|--- Return: pointer to the region if successful, NULL if not, in which case [Ptr] is
+|            left untouched. */
+
 
 #if !defined(TT_STATIC_LIKING)
 #include "tinybase-memory.c"
@@ -0,0 +1,429 @@
+//========================================
+// Memory
+//========================================
+
+#define VM_ARENA_DEFAULT_CHUNK Kilobyte(64)
+
+external bool
+ReserveVMArena(vm_arena* Arena, usz ReserveSize, usz CommitChunk)
+{
+    memset(Arena, 0, sizeof(vm_arena));
+    usz PageSize = gSysInfo.PageSize ? gSysInfo.PageSize : 4096;
+    CommitChunk = (CommitChunk) ? Align(CommitChunk, PageSize) : VM_ARENA_DEFAULT_CHUNK;
+    
+    buffer Range = ReserveMemory(ReserveSize, NULL);
+    if (Range.Base)
+    {
+        Arena->Base = Range.Base;
+        Arena->ReservedSize = Range.Size;
+        Arena->CommitChunk = CommitChunk;
+        return true;
+    }
+    return false;
+}
+
+external void*
+PushIntoVMArenaAligned(vm_arena* Arena, usz Size, usz Alignment)
+{
+    // Checked against the space left before adding, so a huge [Size] can't wrap around.
+    usz Address = (usz)Arena->Base + Arena->WriteCur;
+    usz Padding = (Align(Address, Alignment)) - Address;
+    usz Remaining = Arena->ReservedSize - Arena->WriteCur;
+    if (Padding > Remaining || Size > Remaining - Padding) return NULL;
+    usz NewWriteCur = Arena->WriteCur + Padding + Size;
+    
+    if (NewWriteCur > Arena->Size)
+    {
+        usz NewSize = Min(Align(NewWriteCur, Arena->CommitChunk), Arena->ReservedSize);
+        if (!CommitMemory(Arena->Base + Arena->Size, NewSize - Arena->Size, MEM_WRITE))
+        {
+            return NULL;
+        }
+        Arena->Size = NewSize;
+    }
+    
+    void* Result = Arena->Base + Arena->WriteCur + Padding;
+    Arena->WriteCur = NewWriteCur;
+    return Result;
+}
+
+external void*
+PushIntoVMArena(vm_arena* Arena, usz Size)
+{
+    void* Result = PushIntoVMArenaAligned(Arena, Size, 1);
+    return Result;
+}
+
+external void
+ResetVMArena(vm_arena* Arena, bool Decommit)
+{
+    Arena->WriteCur = 0;
+    if (Decommit && Arena->Size > 0)
+    {
+        DecommitMemory(Arena->Base, Arena->Size);
+        Arena->Size = 0;
+    }
+}
+
+external void
+FreeVMArena(vm_arena* Arena)
+{
+    if (Arena->Base)
+    {
+        buffer Range = Buffer(Arena->Base, 0, Arena->ReservedSize);
+        FreeMemory(&Range);
+    }
+    memset(Arena, 0, sizeof(vm_arena));
+}
+
+global thread_local vm_arena _tScratchArenas[SCRATCH_ARENA_COUNT];
+
+external vm_arena*
+GetScratchArena(buffer** Conflicts, usz NumConflicts)
+{
+    for (usz Idx = 0; Idx < SCRATCH_ARENA_COUNT; Idx++)
+    {
+        vm_arena* Scratch = &_tScratchArenas[Idx];
+        bool InUse = false;
+        for (usz Conflict = 0; Conflict < NumConflicts; Conflict++)
+        {
+            if (Conflicts[Conflict] == &Scratch->Buffer)
+            {
+                InUse = true;
+                break;
+            }
+        }
+        
+        if (!InUse)
+        {
+            if (!Scratch->Base
+                && !ReserveVMArena(Scratch, SCRATCH_ARENA_RESERVE, 0))
+            {
+                return NULL;
+            }
+            return Scratch;
+        }
+    }
+    return NULL;
+}
+
+external void
+FreeScratchArenas(void)
+{
+    for (usz Idx = 0; Idx < SCRATCH_ARENA_COUNT; Idx++)
+    {
+        FreeVMArena(&_tScratchArenas[Idx]);
+    }
+}
+
+
+//========================================
+// Slab allocator
+//========================================
+
+internal usz
+_GetSlabClass(usz Size)
+{
+    // Class 0 holds objects of up to SLAB_MIN_OBJECT bytes, and each class after it doubles.
+    usz Result = (usz)GetLastBitSet((Size-1) | (SLAB_MIN_OBJECT-1)) - (SLAB_MIN_SHIFT-1);
+    return Result;
+}
+
+external void
+InitSlabAllocator(slab_allocator* Slab)
+{
+    for (usz Class = 0; Class < SLAB_NUM_CLASSES; Class++)
+    {
+        InitPool(&Slab->Classes[Class], NULL, 0, (usz)SLAB_MIN_OBJECT << Class);
+    }
+    Slab->Slabs = NULL;
+}
+
+external void*
+SlabAlloc(slab_allocator* Slab, usz Size)
+{
+    if (Size-1 >= SLAB_MAX_OBJECT)
+    {
+        buffer Mem = GetMemory(Size, NULL, MEM_WRITE);
+        return Mem.Base;
+    }
+    
+    pool* Pool = &Slab->Classes[_GetSlabClass(Size)];
+    void* Result = PoolAlloc(Pool);
+    if (!Result)
+    {
+        buffer Mem = GetMemory(SLAB_SIZE, NULL, MEM_WRITE);
+        if (!Mem.Base) return NULL;
+        
+        // The first bytes of each slab link it to the others, so they can all be freed.
+        *(void**)Mem.Base = Slab->Slabs;
+        Slab->Slabs = Mem.Base;
+        Pool->Arena = Buffer(Mem.Base, SLAB_HEADER_SIZE, SLAB_SIZE);
+        Result = PoolAlloc(Pool);
+    }
+    return Result;
+}
+
+external void
+SlabFree(slab_allocator* Slab, void* Ptr, usz Size)
+{
+    if (Size-1 >= SLAB_MAX_OBJECT)
+    {
+        buffer Mem = Buffer(Ptr, 0, Size);
+        FreeMemory(&Mem);
+    }
+    else
+    {
+        PoolFree(&Slab->Classes[_GetSlabClass(Size)], Ptr);
+    }
+}
+
+external void
+FreeSlabAllocator(slab_allocator* Slab)
+{
+    u8* Ptr = (u8*)Slab->Slabs;
+    while (Ptr)
+    {
+        u8* Next = *(u8**)Ptr;
+        buffer Mem = Buffer(Ptr, 0, SLAB_SIZE);
+        FreeMemory(&Mem);
+        Ptr = Next;
+    }
+    InitSlabAllocator(Slab);
+}
+
+external TLSF_GROW_PROC(GrowTLSFFromMemory)
+{
+    // The first TLSF_ALIGN bytes of each region hold the previous region and the size of
+    // this one, and [.GrowArg] points to the newest, so FreeTLSF() can walk them all.
+    usz Size = Max(MinSize + TLSF_REGION_OVERHEAD + TLSF_ALIGN, TLSF_GROW_SIZE);
+    buffer Mem = GetMemory(Size, NULL, MEM_WRITE);
+    if (Mem.Base)
+    {
+        if (AddTLSFRegion(Allocator, Mem.Base + TLSF_ALIGN, Mem.Size - TLSF_ALIGN))
+        {
+            ((void**)Mem.Base)[0] = Allocator->GrowArg;
+            ((usz*)Mem.Base)[1] = Mem.Size;
+            Allocator->GrowArg = Mem.Base;
+            return true;
+        }
+        FreeMemory(&Mem);
+    }
+    return false;
+}
+
+external void
+FreeTLSF(tlsf* Allocator)
+{
+    u8* Ptr = (u8*)Allocator->GrowArg;
+    while (Ptr)
+    {
+        u8* Next = ((u8**)Ptr)[0];
+        buffer Mem = Buffer(Ptr, 0, ((usz*)Ptr)[1]);
+        FreeMemory(&Mem);
+        Ptr = Next;
+    }
+    InitTLSF(Allocator, GrowTLSFFromMemory, NULL);
+}
+
+
+//========================================
+// Synchronization
+//========================================
+
+// The locks are built on the atomics and futex calls of each system, which live in its
+// own file (_SyncLoad(), _SyncExchange(), _FutexWait() and the like).
+
+#define MUTEX_SPIN_COUNT 100
+
+external mutex
+InitMutex(void)
+{
+    mutex Result = {0};
+    return Result;
+}
+
+external bool
+CloseMutex(mutex* Mutex)
+{
+    return (_SyncLoad(&Mutex->State) == 0);
+}
+
+external bool
+TryLockMutex(mutex* Mutex)
+{
+    u32 Expected = 0;
+    return _SyncCompareExchange(&Mutex->State, &Expected, 1);
+}
+
+internal void
+_LockMutexContended(mutex* Mutex)
+{
+    // Marks the mutex as contended, so whoever unlocks it knows to wake someone up.
+    while (_SyncExchange(&Mutex->State, 2) != 0)
+    {
+        _FutexWait(&Mutex->State, 2, TIMEOUT_INFINITE);
+    }
+}
+
+external bool
+LockOnMutex(mutex* Mutex)
+{
+    if (TryLockMutex(Mutex)) return true;
+    
+    for (i32 Spin = 0; Spin < MUTEX_SPIN_COUNT; Spin++)
+    {
+        if (_SyncLoad(&Mutex->State) == 0
+            && TryLockMutex(Mutex))
+        {
+            return true;
+        }
+        CpuPause();
+    }
+    
+    _LockMutexContended(Mutex);
+    return true;
+}
+
+external bool
+UnlockMutex(mutex* Mutex)
+{
+    if (_SyncExchange(&Mutex->State, 0) == 2)
+    {
+        _FutexWake(&Mutex->State, false);
+    }
+    return true;
+}
+
+external rwlock
+InitRWLock(void)
+{
+    rwlock Result = {0};
+    return Result;
+}
+
+internal void
+_WaitOnRWLock(rwlock* Lock, u32 State, i32* Spin)
+{
+    if (*Spin < MUTEX_SPIN_COUNT)
+    {
+        (*Spin)++;
+        CpuPause();
+        return;
+    }
+    
+    // Sets the waiters flag before sleeping, so the thread that releases the lock knows to
+    // wake this one up. If [.State] changes in the meantime, the futex returns right away.
+    u32 Waiting = State | RWLOCK_WAITERS;
+    if (State == Waiting || _SyncCompareExchange(&Lock->State, &State, Waiting))
+    {
+        _FutexWait(&Lock->State, (i32)Waiting, TIMEOUT_INFINITE);
+    }
+}
+
+external void
+LockForReading(rwlock* Lock)
+{
+    i32 Spin = 0;
+    u32 State = _SyncLoad(&Lock->State);
+    for (;;)
+    {
+        if (!(State & RWLOCK_WRITER))
+        {
+            if (_SyncCompareExchange(&Lock->State, &State, State + 1)) return;
+        }
+        else
+        {
+            _WaitOnRWLock(Lock, State, &Spin);
+            State = _SyncLoad(&Lock->State);
+        }
+    }
+}
+
+external void
+UnlockForReading(rwlock* Lock)
+{
+    u32 State = _SyncAddFetch(&Lock->State, (u32)-1);
+    if (State == RWLOCK_WAITERS)
+    {
+        // If this fails, a reader or writer got in, and it will do the waking instead.
+        if (_SyncCompareExchange(&Lock->State, &State, 0))
+        {
+            _FutexWake(&Lock->State, true);
+        }
+    }
+}
+
+external void
+LockForWriting(rwlock* Lock)
+{
+    i32 Spin = 0;
+    u32 State = _SyncLoad(&Lock->State);
+    for (;;)
+    {
+        if ((State & ~RWLOCK_WAITERS) == 0)
+        {
+            if (_SyncCompareExchange(&Lock->State, &State, State | RWLOCK_WRITER)) return;
+        }
+        else
+        {
+            _WaitOnRWLock(Lock, State, &Spin);
+            State = _SyncLoad(&Lock->State);
+        }
+    }
+}
+
+external void
+UnlockForWriting(rwlock* Lock)
+{
+    if (_SyncExchange(&Lock->State, 0) & RWLOCK_WAITERS)
+    {
+        _FutexWake(&Lock->State, true);
+    }
+}
+
+external condvar
+InitCondVar(void)
+{
+    condvar Result = {0};
+    return Result;
+}
+
+external bool
+WaitOnCondVar(condvar* Cond, mutex* Mutex, usz TimeoutMs)
+{
+    u32 Seq = _SyncLoad(&Cond->Seq);
+    UnlockMutex(Mutex);
+    bool Result = _FutexWait(&Cond->Seq, (i32)Seq, TimeoutMs);
+    
+    // Other threads may have been woken up alongside this one, so it can't know whether
+    // the mutex is contended anymore.
+    _LockMutexContended(Mutex);
+    return Result;
+}
+
+external void
+SignalCondVar(condvar* Cond)
+{
+    _SyncAddFetch(&Cond->Seq, 1);
+    _FutexWake(&Cond->Seq, false);
+}
+
+external void
+BroadcastCondVar(condvar* Cond)
+{
+    _SyncAddFetch(&Cond->Seq, 1);
+    _FutexWake(&Cond->Seq, true);
+}
+
+external bool
+WaitOnFutex(void* Address, i32 Expected, usz TimeoutMs)
+{
+    return _FutexWait(Address, Expected, TimeoutMs);
+}
+
+external bool
+WakeFutex(void* Address, bool WakeAll)
+{
+    return _FutexWake(Address, WakeAll);
+}
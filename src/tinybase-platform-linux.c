@@ -7,7 +7,11 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <linux/fs.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <linux/mempolicy.h>
 #include <linux/version.h>
 #include <pthread.h>
 #include <sched.h>
@@ -17,19 +21,220 @@
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <sys/uio.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifndef RWF_APPEND
+# define RWF_APPEND 0x00000010 // Linux 4.16; older headers don't have it.
+#endif
+
 //========================================
 // Config
 //========================================
 
+internal usz
+_GetCpuPath(char* Dst, usz DstSize, usz Cpu, const char* Path)
+{
+    // Writes "/sys/devices/system/cpu/cpu<Cpu>/<Path>" into [Dst].
+    const char* Prefix = "/sys/devices/system/cpu/cpu";
+    usz Len = 0;
+    while (*Prefix) Dst[Len++] = *Prefix++;
+    
+    char Digits[20];
+    usz NumDigits = 0;
+    do { Digits[NumDigits++] = '0' + (Cpu % 10); Cpu /= 10; } while (Cpu);
+    while (NumDigits) Dst[Len++] = Digits[--NumDigits];
+    
+    Dst[Len++] = '/';
+    while (*Path && Len < DstSize-1) Dst[Len++] = *Path++;
+    Dst[Len] = 0;
+    return Len;
+}
+
+internal isz
+_ReadCpuFile(usz Cpu, const char* Path, char* Text, usz TextSize)
+{
+    char FullPath[128];
+    _GetCpuPath(FullPath, sizeof(FullPath), Cpu, Path);
+    isz Result = -1;
+    int File = open(FullPath, O_RDONLY);
+    if (File != -1)
+    {
+        Result = read(File, Text, TextSize);
+        close(File);
+    }
+    return Result;
+}
+
+internal usz
+_ReadCpuValue(usz Cpu, const char* Path)
+{
+    // Values are numbers like "3", or sizes like "2048K".
+    char Text[32];
+    isz TextSize = _ReadCpuFile(Cpu, Path, Text, sizeof(Text));
+    if (TextSize <= 0 || Text[0] < '0' || Text[0] > '9') return USZ_MAX;
+    
+    usz Result = 0;
+    isz Idx = 0;
+    for (; Idx < TextSize && Text[Idx] >= '0' && Text[Idx] <= '9'; Idx++)
+    {
+        Result = Result * 10 + (Text[Idx] - '0');
+    }
+    if (Idx < TextSize && Text[Idx] == 'K') Result *= 1024;
+    else if (Idx < TextSize && Text[Idx] == 'M') Result *= 1024 * 1024;
+    return Result;
+}
+
+internal u16
+_ReadCpuNode(usz Cpu)
+{
+    // The node is only known from the "node<N>" link in the CPU's folder.
+    u16 Result = 0;
+    char Path[64];
+    _GetCpuPath(Path, sizeof(Path), Cpu, "");
+    DIR* Dir = opendir(Path);
+    if (Dir)
+    {
+        struct dirent* Entry;
+        while ((Entry = readdir(Dir)) != NULL)
+        {
+            char* Name = Entry->d_name;
+            if (Name[0] == 'n' && Name[1] == 'o' && Name[2] == 'd' && Name[3] == 'e'
+                && Name[4] >= '0' && Name[4] <= '9')
+            {
+                for (char* Digit = Name + 4; *Digit >= '0' && *Digit <= '9'; Digit++)
+                {
+                    Result = Result * 10 + (*Digit - '0');
+                }
+                break;
+            }
+        }
+        closedir(Dir);
+    }
+    return Result;
+}
+
+global u64 _OnlineCpus[MAX_CPU_INFO/64];
+
+internal bool
+_IsCpuOnline(usz Cpu)
+{
+    return Cpu < MAX_CPU_INFO && (_OnlineCpus[Cpu/64] & (1ULL << (Cpu % 64)));
+}
+
+internal void
+_LoadOnlineCpus(void)
+{
+    // The list looks like "0-3,8,10-11"; CPU ids can have holes when some are offline.
+    char Text[1024];
+    isz TextSize = -1;
+    int File = open("/sys/devices/system/cpu/online", O_RDONLY);
+    if (File != -1)
+    {
+        TextSize = read(File, Text, sizeof(Text));
+        close(File);
+    }
+    
+    memset(_OnlineCpus, 0, sizeof(_OnlineCpus));
+    if (TextSize <= 0)
+    {
+        for (usz Cpu = 0; Cpu < Min(gSysInfo.NumThreads, MAX_CPU_INFO); Cpu++)
+        {
+            _OnlineCpus[Cpu/64] |= 1ULL << (Cpu % 64);
+        }
+        return;
+    }
+    
+    for (isz Idx = 0; Idx < TextSize && Text[Idx] >= '0' && Text[Idx] <= '9';)
+    {
+        usz First = 0, Last;
+        for (; Idx < TextSize && Text[Idx] >= '0' && Text[Idx] <= '9'; Idx++)
+        {
+            First = First * 10 + (Text[Idx] - '0');
+        }
+        Last = First;
+        if (Idx < TextSize && Text[Idx] == '-')
+        {
+            Last = 0;
+            for (Idx++; Idx < TextSize && Text[Idx] >= '0' && Text[Idx] <= '9'; Idx++)
+            {
+                Last = Last * 10 + (Text[Idx] - '0');
+            }
+        }
+        for (usz Cpu = First; Cpu <= Last && Cpu < MAX_CPU_INFO; Cpu++)
+        {
+            _OnlineCpus[Cpu/64] |= 1ULL << (Cpu % 64);
+        }
+        if (Idx < TextSize && Text[Idx] == ',') Idx++;
+    }
+}
+
+internal void
+_LoadCpuTopology(void)
+{
+    usz CoreIds[MAX_CPU_INFO];
+    usz FirstCpu = USZ_MAX;
+    gSysInfo.NumCores = 0;
+    gSysInfo.NumNodes = 1;
+    _LoadOnlineCpus();
+    
+    for (usz Cpu = 0; Cpu < MAX_CPU_INFO; Cpu++)
+    {
+        if (!_IsCpuOnline(Cpu)) continue;
+        if (FirstCpu == USZ_MAX) FirstCpu = Cpu;
+        cpu_info* Info = &gSysInfo.Cpus[Cpu];
+        usz Package = _ReadCpuValue(Cpu, "topology/physical_package_id");
+        usz CoreId = _ReadCpuValue(Cpu, "topology/core_id");
+        Info->Package = (u16)((Package == USZ_MAX) ? 0 : Package);
+        Info->Node = _ReadCpuNode(Cpu);
+        gSysInfo.NumNodes = Max(gSysInfo.NumNodes, (usz)Info->Node + 1);
+        
+        // Core ids are only unique inside a package, so cores are renumbered from zero, and
+        // CPUs found on a core already seen are its hyperthreads.
+        Info->Core = (u16)gSysInfo.NumCores;
+        Info->Sibling = 0;
+        for (usz Prev = 0; Prev < Cpu; Prev++)
+        {
+            if (_IsCpuOnline(Prev) && gSysInfo.Cpus[Prev].Package == Info->Package && CoreIds[Prev] == CoreId)
+            {
+                Info->Core = gSysInfo.Cpus[Prev].Core;
+                Info->Sibling++;
+            }
+        }
+        if (Info->Sibling == 0) gSysInfo.NumCores++;
+        CoreIds[Cpu] = CoreId;
+    }
+    
+    if (FirstCpu == USZ_MAX) return;
+    for (char Index = '0'; Index <= '9'; Index++)
+    {
+        char Level[] = "cache/index0/level";
+        char Type[] = "cache/index0/type";
+        char Size[] = "cache/index0/size";
+        Level[11] = Type[11] = Size[11] = Index;
+        
+        usz LevelNum = _ReadCpuValue(FirstCpu, Level);
+        if (LevelNum == USZ_MAX) break;
+        
+        // Level 1 has a data and an instruction cache; only the data one is kept.
+        char TypeChar = 0;
+        usz SizeNum = _ReadCpuValue(FirstCpu, Size);
+        if (_ReadCpuFile(FirstCpu, Type, &TypeChar, 1) == 1 && TypeChar != 'I'
+            && LevelNum >= 1 && LevelNum <= 3 && SizeNum != USZ_MAX)
+        {
+            gSysInfo.CacheSizes[LevelNum-1] = SizeNum;
+        }
+    }
+}
+
 external void
 LoadSystemInfo(void)
 {
@@ -41,6 +246,38 @@ LoadSystemInfo(void)
     gSysInfo.MemBlockSize = gSysInfo.PageSize;
     gSysInfo.NumThreads = get_nprocs();
     
+    // Each huge page size the kernel supports has a folder named "hugepages-<size>kB".
+    DIR* HugePages = opendir("/sys/kernel/mm/hugepages");
+    if (HugePages)
+    {
+        struct dirent* Entry;
+        while ((Entry = readdir(HugePages)) != NULL)
+        {
+            char* Name = Entry->d_name;
+            if (!CompareBuffers(Buffer(Name, 10, 0), Buffer((void*)"hugepages-", 10, 0), 10,
+                                RETURN_BOOL)) continue;
+            usz SizeKB = 0;
+            for (char* Digit = Name + 10; *Digit >= '0' && *Digit <= '9'; Digit++)
+            {
+                SizeKB = SizeKB * 10 + (*Digit - '0');
+            }
+            
+            usz Size = SizeKB * 1024;
+            if (!gSysInfo.HugePageSizes[0] || Size < gSysInfo.HugePageSizes[0])
+            {
+                gSysInfo.HugePageSizes[1] = Max(gSysInfo.HugePageSizes[0], gSysInfo.HugePageSizes[1]);
+                gSysInfo.HugePageSizes[0] = Size;
+            }
+            else if (Size > gSysInfo.HugePageSizes[1])
+            {
+                gSysInfo.HugePageSizes[1] = Size;
+            }
+        }
+        closedir(HugePages);
+    }
+    
+    _LoadCpuTopology();
+    
 #if defined(CLOCK_BOOTTIME)
     gSysInfo.TimingFreq = CLOCK_BOOTTIME;
 #else
@@ -65,26 +302,204 @@ ClearMemory(buffer* Mem)
     Mem->WriteCur = 0;
 }
 
-external buffer
-GetMemory(usz Size, void* Address, int Flags)
+internal int
+_GetMemoryProt(int Flags)
 {
-    buffer Result = {0};
-    
     int Prot = 0;
     if (Flags & MEM_READ) Prot |= PROT_READ;
     if (Flags & MEM_WRITE) Prot |= PROT_READ | PROT_WRITE;
     if (Flags & MEM_EXEC) Prot |= PROT_EXEC;
     if (Flags & MEM_GUARD) Prot = PROT_NONE;
-    void* Ptr = mmap(Address, Size, Prot, MAP_PRIVATE|MAP_ANONYMOUS, 0, 0);
+    return Prot;
+}
+
+internal void
+_PrefaultMemory(void* Address, usz Size, int Flags)
+{
+#if defined(MADV_POPULATE_WRITE)
+    int Advice = (Flags & MEM_WRITE) ? MADV_POPULATE_WRITE : MADV_POPULATE_READ;
+    if (madvise(Address, Size, Advice) == 0) return;
+#endif
+    
+    // Kernels older than 5.14 have no way to do it, so one byte of each page is touched.
+    usz PageSize = (gSysInfo.PageSize) ? gSysInfo.PageSize : 4096;
+    for (usz Offset = 0; Offset < Size; Offset += PageSize)
+    {
+        volatile u8* Byte = (volatile u8*)Address + Offset;
+        if (Flags & MEM_WRITE) *Byte = *Byte;
+        else (void)*Byte;
+    }
+}
+
+internal bool
+_LockMemory(buffer* Mem, int Flags)
+{
+    if (Mem->Base && (Flags & MEM_LOCK) && mlock(Mem->Base, Mem->Size) != 0)
+    {
+        FreeMemory(Mem);
+        return false;
+    }
+    return Mem->Base != NULL;
+}
+
+external buffer
+GetHugePageMemory(usz Size, void* Address, int Flags, i32* Kind)
+{
+    buffer Result = {0};
+    i32 Got = HUGEPAGE_NONE;
+    int Prot = _GetMemoryProt(Flags);
+    
+    // Tries the pools of huge pages reserved by the system first, biggest size asked for first.
+    for (i32 Idx = (Flags & MEM_HUGEPAGE_1GB) ? 1 : 0; Idx >= 0 && !Result.Base; Idx--)
+    {
+        usz PageSize = gSysInfo.HugePageSizes[Idx];
+        if (PageSize)
+        {
+            usz HugeSize = Align(Size, PageSize);
+            int HugeFlags = MAP_HUGETLB | (GetLastBitSet(PageSize) << MAP_HUGE_SHIFT);
+            if (Flags & MEM_PREFAULT) HugeFlags |= MAP_POPULATE;
+            void* Ptr = mmap(Address, HugeSize, Prot, MAP_PRIVATE|MAP_ANONYMOUS|HugeFlags, -1, 0);
+            if (Ptr != MAP_FAILED)
+            {
+                Result.Base = (u8*)Ptr;
+                Result.Size = HugeSize;
+                Got = HUGEPAGE_EXPLICIT;
+            }
+        }
+    }
+    
+    if (!Result.Base)
+    {
+        // Maps one extra huge page, so that an aligned range fits in it, and trims the rest.
+        usz PageSize = (gSysInfo.HugePageSizes[0]) ? gSysInfo.HugePageSizes[0] : Megabyte(2);
+        usz HugeSize = Align(Size, PageSize);
+        u8* Ptr = (u8*)mmap(Address, HugeSize + PageSize, Prot, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (Ptr != MAP_FAILED)
+        {
+            u8* Start = (u8*)(Align((usz)Ptr, PageSize));
+            if (Start > Ptr) munmap(Ptr, Start - Ptr);
+            munmap(Start + HugeSize, Ptr + PageSize - Start);
+            
+            Result.Base = Start;
+            Result.Size = HugeSize;
+            if (madvise(Start, HugeSize, MADV_HUGEPAGE) == 0) Got = HUGEPAGE_TRANSPARENT;
+            if (Flags & MEM_PREFAULT) _PrefaultMemory(Start, HugeSize, Flags);
+        }
+    }
+    
+    // The block is freed if it can't be locked, and then there are no pages of any kind.
+    if (!_LockMemory(&Result, Flags)) Got = HUGEPAGE_NONE;
+    if (Kind) *Kind = Got;
+    return Result;
+}
+
+external buffer
+GetMemory(usz Size, void* Address, int Flags)
+{
+    if (Flags & (MEM_HUGEPAGE|MEM_HUGEPAGE_1GB))
+    {
+        return GetHugePageMemory(Size, Address, Flags, NULL);
+    }
+    
+    buffer Result = {0};
+    int Prot = _GetMemoryProt(Flags);
+    int MapFlags = MAP_PRIVATE | MAP_ANONYMOUS | ((Flags & MEM_PREFAULT) ? MAP_POPULATE : 0);
+    void* Ptr = mmap(Address, Size, Prot, MapFlags, 0, 0);
     if (Ptr != MAP_FAILED)
     {
         Result.Base = (u8*)Ptr;
         Result.Size = (gSysInfo.PageSize) ? Align(Size, gSysInfo.PageSize) : Size;
+        _LockMemory(&Result, Flags);
     }
     
     return Result;
 }
 
+#define MAX_NUMA_NODES 256
+
+external buffer
+GetMemoryOnNode(usz Size, i32 Node, int Flags)
+{
+    buffer Result = {0};
+    if (Node < 0 || Node >= MAX_NUMA_NODES) return Result;
+    
+    // Binding has to happen before the pages are touched, so it can't be prefaulted or locked
+    // until after that.
+    Result = GetMemory(Size, NULL, Flags & ~(MEM_PREFAULT|MEM_LOCK));
+    if (Result.Base)
+    {
+        u64 NodeMask[MAX_NUMA_NODES/64] = {0};
+        NodeMask[Node/64] = 1ULL << (Node % 64);
+        if (syscall(SYS_mbind, Result.Base, Result.Size, MPOL_BIND, NodeMask,
+                    MAX_NUMA_NODES + 1, 0) != 0)
+        {
+            FreeMemory(&Result);
+            return Result;
+        }
+        if (Flags & MEM_PREFAULT) _PrefaultMemory(Result.Base, Result.Size, Flags);
+        _LockMemory(&Result, Flags);
+    }
+    return Result;
+}
+
+external bool
+SetThreadMemoryNode(i32 Node)
+{
+    long Ret;
+    if (Node < 0)
+    {
+        Ret = syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+    }
+    else if (Node < MAX_NUMA_NODES)
+    {
+        u64 NodeMask[MAX_NUMA_NODES/64] = {0};
+        NodeMask[Node/64] = 1ULL << (Node % 64);
+        Ret = syscall(SYS_set_mempolicy, MPOL_PREFERRED, NodeMask, MAX_NUMA_NODES + 1);
+    }
+    else return false;
+    return Ret == 0;
+}
+
+external buffer
+ReserveMemory(usz Size, void* Address)
+{
+    buffer Result = {0};
+    void* Ptr = mmap(Address, Size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Ptr != MAP_FAILED)
+    {
+        Result.Base = (u8*)Ptr;
+        Result.Size = (gSysInfo.PageSize) ? Align(Size, gSysInfo.PageSize) : Size;
+    }
+    return Result;
+}
+
+external bool
+CommitMemory(void* Address, usz Size, int Flags)
+{
+    if (mprotect(Address, Size, _GetMemoryProt(Flags)) != 0) return false;
+    if (Flags & MEM_PREFAULT) _PrefaultMemory(Address, Size, Flags);
+    if ((Flags & MEM_LOCK) && mlock(Address, Size) != 0) return false;
+    return true;
+}
+
+external bool
+DecommitMemory(void* Address, usz Size)
+{
+    // Dropping the pages makes them read as zero when committed again; the protection
+    // change makes them inaccessible until then, and unlocks them if they were locked.
+    munlock(Address, Size);
+    bool Result = (madvise(Address, Size, MADV_DONTNEED) == 0
+                   && mprotect(Address, Size, PROT_NONE) == 0);
+    return Result;
+}
+
+external bool
+ProtectMemory(void* Address, usz Size, int Flags)
+{
+    bool Result = (mprotect(Address, Size, _GetMemoryProt(Flags)) == 0);
+    return Result;
+}
+
 external void
 FreeMemory(buffer* Mem)
 {
@@ -117,27 +532,463 @@ FreeMemoryFromHeap(buffer* Mem)
 
 
 //========================================
-// FileIO
+// Async IO
 //========================================
 
-internal file
-_NewFile(void* Filename, bool IsCreate, i32 Flags)
+#define IO_RING_ENTRIES 256
+#define IO_RING_MAX_BUFFERS 16
+#define IO_RING_MAX_FILES 64
+
+#define ASYNC_ENGINE_AIO 1
+#define ASYNC_ENGINE_URING 2
+
+typedef struct _io_ring
 {
-    int OpenOpts = 0, Mode = 0;
-    if (IsCreate)
+    int Fd;
+    i32 State;
+    u32 Entries;
+    u32 Unsubmitted;
+    bool Batching;
+    
+    u32* SqHead;
+    u32* SqTail;
+    u32* SqFlags;
+    u32 SqMask;
+    struct io_uring_sqe* Sqes;
+    u32* CqHead;
+    u32* CqTail;
+    u32 CqMask;
+    struct io_uring_cqe* Cqes;
+    
+    buffer Rings;
+    buffer SqeMem;
+    
+    struct iovec Buffers[IO_RING_MAX_BUFFERS];
+    u32 NumBuffers;
+    int Files[IO_RING_MAX_FILES];
+    u32 NumFiles;
+} _io_ring;
+
+typedef struct _async_io
+{
+    u8 Engine;
+    u8 Failed;
+    i32 Pending;
+    usz Transferred;
+    struct _io_ring* Ring;
+    struct aiocb Aio;
+} _async_io;
+
+internal bool
+_InitIoRing(_io_ring* Ring, u32 Entries)
+{
+    struct io_uring_params Params;
+    memset(&Params, 0, sizeof(Params));
+    int Fd = (int)syscall(SYS_io_uring_setup, Entries, &Params);
+    if (Fd < 0) return false;
+    
+    // Plain (non-vectored) reads and writes came in the same kernel as RW_CUR_POS, and so
+    // did a single mapping for both rings.
+    if (!(Params.features & IORING_FEAT_RW_CUR_POS)
+        || !(Params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close(Fd);
+        return false;
+    }
+    
+    usz SqSize = Params.sq_off.array + Params.sq_entries * sizeof(u32);
+    usz CqSize = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+    usz RingSize = Max(SqSize, CqSize);
+    usz SqeSize = Params.sq_entries * sizeof(struct io_uring_sqe);
+    
+    u8* Rings = (u8*)mmap(0, RingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                          Fd, IORING_OFF_SQ_RING);
+    if (Rings == MAP_FAILED)
+    {
+        close(Fd);
+        return false;
+    }
+    u8* Sqes = (u8*)mmap(0, SqeSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                         Fd, IORING_OFF_SQES);
+    if (Sqes == MAP_FAILED)
     {
-        OpenOpts |= O_CREAT;
-        OpenOpts |= (Flags & FORCE_CREATE) ? O_TRUNC : O_EXCL;
-        Mode = S_IRUSR|S_IWUSR;
+        munmap(Rings, RingSize);
+        close(Fd);
+        return false;
     }
+    
+    Ring->Fd = Fd;
+    Ring->Entries = Params.sq_entries;
+    Ring->Unsubmitted = 0;
+    Ring->Batching = false;
+    Ring->SqHead = (u32*)(Rings + Params.sq_off.head);
+    Ring->SqTail = (u32*)(Rings + Params.sq_off.tail);
+    Ring->SqFlags = (u32*)(Rings + Params.sq_off.flags);
+    Ring->SqMask = *(u32*)(Rings + Params.sq_off.ring_mask);
+    Ring->Sqes = (struct io_uring_sqe*)Sqes;
+    Ring->CqHead = (u32*)(Rings + Params.cq_off.head);
+    Ring->CqTail = (u32*)(Rings + Params.cq_off.tail);
+    Ring->CqMask = *(u32*)(Rings + Params.cq_off.ring_mask);
+    Ring->Cqes = (struct io_uring_cqe*)(Rings + Params.cq_off.cqes);
+    Ring->Rings = Buffer(Rings, 0, RingSize);
+    Ring->SqeMem = Buffer(Sqes, 0, SqeSize);
+    Ring->NumBuffers = 0;
+    Ring->NumFiles = 0;
+    
+    // Entry N of the submission array always points to SQE N, so only the tail has to move.
+    u32* SqArray = (u32*)(Rings + Params.sq_off.array);
+    for (u32 Idx = 0; Idx < Ring->Entries; Idx++)
+    {
+        SqArray[Idx] = Idx;
+    }
+    return true;
+}
+
+internal void
+_CloseIoRing(_io_ring* Ring)
+{
+    munmap(Ring->SqeMem.Base, Ring->SqeMem.Size);
+    munmap(Ring->Rings.Base, Ring->Rings.Size);
+    close(Ring->Fd);
+}
+
+internal u32
+_IoRingSpace(_io_ring* Ring)
+{
+    u32 Head = __atomic_load_n(Ring->SqHead, __ATOMIC_ACQUIRE);
+    u32 Result = Ring->Entries - (*Ring->SqTail - Head);
+    return Result;
+}
+
+internal struct io_uring_sqe*
+_PushIoRingSqe(_io_ring* Ring)
+{
+    u32 Tail = *Ring->SqTail;
+    struct io_uring_sqe* Sqe = &Ring->Sqes[Tail & Ring->SqMask];
+    memset(Sqe, 0, sizeof(struct io_uring_sqe));
+    return Sqe;
+}
+
+internal void
+_PublishIoRingSqe(_io_ring* Ring)
+{
+    __atomic_store_n(Ring->SqTail, *Ring->SqTail + 1, __ATOMIC_RELEASE);
+    Ring->Unsubmitted++;
+}
+
+internal int
+_EnterIoRing(_io_ring* Ring, u32 ToSubmit, u32 MinComplete)
+{
+    u32 Flags = (MinComplete) ? IORING_ENTER_GETEVENTS : 0;
+    int Result;
+    do
+    {
+        Result = (int)syscall(SYS_io_uring_enter, Ring->Fd, ToSubmit, MinComplete, Flags,
+                              NULL, 0);
+    } while (Result < 0 && errno == EINTR);
+    return Result;
+}
+
+internal void
+_FlushIoRingOverflow(_io_ring* Ring)
+{
+    // Completions that didn't fit in the queue are held by the kernel, and only moved back
+    // in when asked for events.
+    if (__atomic_load_n(Ring->SqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)
+    {
+        syscall(SYS_io_uring_enter, Ring->Fd, 0, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+}
+
+internal void
+_ReapIoRing(_io_ring* Ring)
+{
+    _FlushIoRingOverflow(Ring);
+    u32 Head = *Ring->CqHead;
+    u32 Tail = __atomic_load_n(Ring->CqTail, __ATOMIC_ACQUIRE);
+    for (; Head != Tail; Head++)
+    {
+        struct io_uring_cqe* Cqe = &Ring->Cqes[Head & Ring->CqMask];
+        _async_io* Io = (_async_io*)(usz)Cqe->user_data;
+        if (Cqe->res < 0) Io->Failed = true;
+        else Io->Transferred += (usz)Cqe->res;
+        Io->Pending--;
+    }
+    __atomic_store_n(Ring->CqHead, Head, __ATOMIC_RELEASE);
+}
+
+internal bool
+_SubmitIoRing(_io_ring* Ring)
+{
+    // Fails with EBUSY or EAGAIN when the completion queue is backed up, in which case the
+    // owner of the ring has to reap it before trying again.
+    while (Ring->Unsubmitted)
+    {
+        int Submitted = _EnterIoRing(Ring, Ring->Unsubmitted, 0);
+        if (Submitted < 0) return false;
+        Ring->Unsubmitted -= (u32)Submitted;
+    }
+    return true;
+}
+
+internal bool
+_SubmitAsyncRing(_io_ring* Ring)
+{
+    if (_SubmitIoRing(Ring)) return true;
+    if (errno != EBUSY && errno != EAGAIN) return false;
+    _ReapIoRing(Ring);
+    return _SubmitIoRing(Ring);
+}
+
+global thread_local _io_ring _tIoRing;
+global pthread_key_t _IoRingKey;
+global pthread_once_t _IoRingKeyOnce = PTHREAD_ONCE_INIT;
+
+internal void
+_IoRingThreadExit(void* Arg)
+{
+    _io_ring* Ring = (_io_ring*)Arg;
+    _CloseIoRing(Ring);
+    Ring->State = 0;
+}
+
+internal void
+_InitIoRingKey(void)
+{
+    pthread_key_create(&_IoRingKey, _IoRingThreadExit);
+}
+
+internal _io_ring*
+_GetIoRing(void)
+{
+    _io_ring* Ring = &_tIoRing;
+    if (Ring->State == 0)
+    {
+        Ring->State = _InitIoRing(Ring, IO_RING_ENTRIES) ? ASYNC_ENGINE_URING : ASYNC_ENGINE_AIO;
+        if (Ring->State == ASYNC_ENGINE_URING)
+        {
+            // The key's destructor releases the ring when the thread exits, in case the
+            // application never calls CloseAsyncIo().
+            pthread_once(&_IoRingKeyOnce, _InitIoRingKey);
+            pthread_setspecific(_IoRingKey, Ring);
+        }
+    }
+    return (Ring->State == ASYNC_ENGINE_URING) ? Ring : NULL;
+}
+
+internal bool
+_StartAsyncIo(file File, u8* Ptr, usz Size, usz StartPos, async* Async, bool IsWrite)
+{
+    _async_io* Io = (_async_io*)Async->Data;
+    Io->Failed = false;
+    Io->Pending = 0;
+    Io->Transferred = 0;
+    
+    _io_ring* Ring = _GetIoRing();
+    if (!Ring)
+    {
+        Io->Engine = ASYNC_ENGINE_AIO;
+        memset(&Io->Aio, 0, sizeof(struct aiocb));
+        Io->Aio.aio_fildes = (int)File;
+        Io->Aio.aio_buf = Ptr;
+        Io->Aio.aio_nbytes = Size;
+        Io->Aio.aio_offset = (off_t)StartPos;
+        int Result = (IsWrite) ? aio_write(&Io->Aio) : aio_read(&Io->Aio);
+        return (Result == 0);
+    }
+    
+    Io->Engine = ASYNC_ENGINE_URING;
+    Io->Ring = Ring;
+    u32 NumChunks = (u32)Max((Size + U32_MAX - 1) / U32_MAX, 1);
+    if (_IoRingSpace(Ring) < NumChunks
+        && (!_SubmitAsyncRing(Ring) || _IoRingSpace(Ring) < NumChunks))
+    {
+        return false;
+    }
+    
+    u8 Opcode = (IsWrite) ? IORING_OP_WRITE : IORING_OP_READ;
+    u16 BufIdx = 0;
+    for (u32 Idx = 0; Idx < Ring->NumBuffers; Idx++)
+    {
+        u8* Base = (u8*)Ring->Buffers[Idx].iov_base;
+        if (Ptr >= Base && Ptr + Size <= Base + Ring->Buffers[Idx].iov_len)
+        {
+            Opcode = (IsWrite) ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            BufIdx = (u16)Idx;
+            break;
+        }
+    }
+    
+    i32 Fd = (i32)File;
+    u8 SqeFlags = 0;
+    for (u32 Idx = 0; Idx < Ring->NumFiles; Idx++)
+    {
+        if (Ring->Files[Idx] == (int)File)
+        {
+            Fd = (i32)Idx;
+            SqeFlags = IOSQE_FIXED_FILE;
+            break;
+        }
+    }
+    
+    for (u32 Chunk = 0; Chunk < NumChunks; Chunk++)
+    {
+        u32 ChunkSize = (u32)Min(Size, U32_MAX);
+        struct io_uring_sqe* Sqe = _PushIoRingSqe(Ring);
+        Sqe->opcode = Opcode;
+        Sqe->flags = SqeFlags;
+        Sqe->fd = Fd;
+        Sqe->off = (u64)StartPos;
+        Sqe->addr = (u64)(usz)Ptr;
+        Sqe->len = ChunkSize;
+        Sqe->buf_index = BufIdx;
+        Sqe->user_data = (u64)(usz)Io;
+        _PublishIoRingSqe(Ring);
+        
+        Io->Pending++;
+        Ptr += ChunkSize;
+        StartPos += ChunkSize;
+        Size -= ChunkSize;
+    }
+    
+    if (Ring->Batching || _SubmitAsyncRing(Ring))
+    {
+        return true;
+    }
+    
+    // The caller is told the IO never started, so the entries are taken back, as long as
+    // the kernel hasn't seen any of them (it only reads the tail when entered).
+    if (Ring->Unsubmitted >= NumChunks)
+    {
+        __atomic_store_n(Ring->SqTail, *Ring->SqTail - NumChunks, __ATOMIC_RELEASE);
+        Ring->Unsubmitted -= NumChunks;
+        return false;
+    }
+    return true;
+}
+
+external void
+BeginIoBatch(void)
+{
+    _io_ring* Ring = _GetIoRing();
+    if (Ring) Ring->Batching = true;
+}
+
+external bool
+EndIoBatch(void)
+{
+    bool Result = true;
+    _io_ring* Ring = _GetIoRing();
+    if (Ring)
+    {
+        Ring->Batching = false;
+        Result = _SubmitAsyncRing(Ring);
+    }
+    return Result;
+}
+
+external bool
+RegisterIoBuffers(buffer* Buffers, u32 Count)
+{
+    _io_ring* Ring = _GetIoRing();
+    if (!Ring || Count > IO_RING_MAX_BUFFERS) return false;
+    
+    if (Ring->NumBuffers)
+    {
+        syscall(SYS_io_uring_register, Ring->Fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+        Ring->NumBuffers = 0;
+    }
+    if (Count)
+    {
+        for (u32 Idx = 0; Idx < Count; Idx++)
+        {
+            Ring->Buffers[Idx].iov_base = Buffers[Idx].Base;
+            Ring->Buffers[Idx].iov_len = Buffers[Idx].Size;
+        }
+        if (syscall(SYS_io_uring_register, Ring->Fd, IORING_REGISTER_BUFFERS,
+                    Ring->Buffers, Count) < 0)
+        {
+            return false;
+        }
+        Ring->NumBuffers = Count;
+    }
+    return true;
+}
+
+external bool
+RegisterIoFiles(file* Files, u32 Count)
+{
+    _io_ring* Ring = _GetIoRing();
+    if (!Ring || Count > IO_RING_MAX_FILES) return false;
+    
+    if (Ring->NumFiles)
+    {
+        syscall(SYS_io_uring_register, Ring->Fd, IORING_UNREGISTER_FILES, NULL, 0);
+        Ring->NumFiles = 0;
+    }
+    if (Count)
+    {
+        for (u32 Idx = 0; Idx < Count; Idx++)
+        {
+            Ring->Files[Idx] = (int)Files[Idx];
+        }
+        if (syscall(SYS_io_uring_register, Ring->Fd, IORING_REGISTER_FILES,
+                    Ring->Files, Count) < 0)
+        {
+            return false;
+        }
+        Ring->NumFiles = Count;
+    }
+    return true;
+}
+
+external void
+CloseAsyncIo(void)
+{
+    _io_ring* Ring = &_tIoRing;
+    if (Ring->State == ASYNC_ENGINE_URING)
+    {
+        pthread_setspecific(_IoRingKey, NULL);
+        _CloseIoRing(Ring);
+    }
+    Ring->State = 0;
+}
+
+
+//========================================
+// FileIO
+//========================================
+
+internal int
+_GetOpenOpts(i32 Flags, bool IsCreate)
+{
+    // Shared by the file functions and QueueFileOpen(), so [Flags] mean the same for both.
+    int Result = 0;
     bool Read = (Flags & (READ_SOLO|READ_SHARE)) > 0;
     bool Write = (Flags & (WRITE_SOLO|WRITE_SHARE)) > 0;
     
-    if (Read && Write) OpenOpts |= O_RDWR;
-    else if (Read) OpenOpts |= O_RDONLY;
-    else if (Write) OpenOpts |= O_WRONLY;
-    if (Flags & APPEND_FILE) OpenOpts |= O_APPEND;
-    if (Flags & ASYNC_FILE) OpenOpts |= (O_ASYNC|O_NONBLOCK);
+    if (Read && Write) Result |= O_RDWR;
+    else if (Read) Result |= O_RDONLY;
+    else if (Write) Result |= O_WRONLY;
+    if (Flags & APPEND_FILE) Result |= O_APPEND;
+    
+    if (IsCreate)
+    {
+        Result |= O_CREAT | ((Flags & FORCE_CREATE) ? O_TRUNC : O_EXCL);
+    }
+    else
+    {
+        if (Flags & FORCE_OPEN) Result |= O_CREAT;
+        if (Flags & FORCE_CREATE) Result |= O_TRUNC;
+    }
+    return Result;
+}
+
+internal file
+_NewFile(void* Filename, bool IsCreate, i32 Flags)
+{
+    int OpenOpts = _GetOpenOpts(Flags, IsCreate);
+    int Mode = (OpenOpts & O_CREAT) ? S_IRUSR|S_IWUSR : 0;
     
     char NewBuf[MAX_PATH_SIZE];
     if (Flags & HIDDEN_FILE)
@@ -176,10 +1027,6 @@ external file
 OpenFileHandle(void* Filename, i32 Flags)
 {
     file Result = _NewFile(Filename, 0, Flags);
-    if ((Flags & FORCE_OPEN) && Result == INVALID_FILE)
-    {
-        Result = _NewFile(Filename, 1, Flags);
-    }
     return Result;
 }
 
@@ -229,115 +1076,236 @@ SeekFile(file File, usz Pos)
 
 external bool
 ReadFromFile(file File, buffer* Dst, usz AmountToRead, usz StartPos)
+{
+    if (AmountToRead > (Dst->Size - Dst->WriteCur))
+    {
+        return false;
+    }
+    
+    // Positional reads leave the file offset alone, so threads can share the handle.
+    u8* Ptr = Dst->Base + Dst->WriteCur;
+    for (usz AmountRead = 0; AmountRead < AmountToRead; )
+    {
+        ssize_t BytesRead = pread((int)File, Ptr + AmountRead, AmountToRead - AmountRead,
+                                  (off_t)(StartPos + AmountRead));
+        if (BytesRead < 0 && errno == EINTR) continue;
+        if (BytesRead <= 0) return false;
+        AmountRead += (usz)BytesRead;
+    }
+    Dst->WriteCur += AmountToRead;
+    return true;
+}
+
+external buffer
+ReadEntireFile(file File)
 {
     usz FileSize = FileSizeOf(File);
-    if ((StartPos + AmountToRead) <= FileSize
-        && AmountToRead <= (Dst->Size - Dst->WriteCur))
+    buffer Mem = GetMemory(FileSize, 0, MEM_WRITE);
+    if (Mem.Base)
     {
-        SeekFile(File, StartPos);
-        ssize_t BytesRead = read((int)File, Dst->Base + Dst->WriteCur, AmountToRead);
-        if (BytesRead != AmountToRead)
+        if (ReadFromFile(File, &Mem, FileSize, 0))
         {
-            return false;
+            Mem.WriteCur = FileSize;
         }
+        else
+        {
+            FreeMemory(&Mem);
+        }
+    }
+    return Mem;
+}
+
+external bool
+ReadFileAsync(file File, buffer* Dst, usz AmountToRead, usz StartPos, async* Async)
+{
+    if (AmountToRead <= (Dst->Size - Dst->WriteCur)
+        && _StartAsyncIo(File, Dst->Base + Dst->WriteCur, AmountToRead, StartPos, Async, false))
+    {
         Dst->WriteCur += AmountToRead;
         return true;
     }
     return false;
 }
 
-external buffer
-ReadEntireFile(file File)
+internal bool
+_WriteToFile(int Fd, u8* Src, usz Size, usz StartPos)
 {
-    usz FileSize = FileSizeOf(File);
-    buffer Mem = GetMemory(FileSize, 0, MEM_WRITE);
-    if (Mem.Base)
+    for (usz AmountWritten = 0; AmountWritten < Size; )
+    {
+        ssize_t BytesWritten = pwrite(Fd, Src + AmountWritten, Size - AmountWritten,
+                                      (off_t)(StartPos + AmountWritten));
+        if (BytesWritten < 0 && errno == EINTR) continue;
+        if (BytesWritten <= 0) return false;
+        AmountWritten += (usz)BytesWritten;
+    }
+    return true;
+}
+
+internal bool
+_AppendThroughProc(int Fd, u8* Src, usz Size)
+{
+    // Kernels without RWF_APPEND (pre-4.16) get a second descriptor opened with O_APPEND,
+    // so each write still lands at EOF atomically, without changing the flags of [Fd].
+    char Path[32];
+    snprintf(Path, sizeof(Path), "/proc/self/fd/%d", Fd);
+    int AppendFd = open(Path, O_WRONLY|O_APPEND);
+    if (AppendFd < 0) return false;
+    
+    bool Result = true;
+    for (usz AmountWritten = 0; Result && AmountWritten < Size; )
     {
-        if (ReadFromFile(File, &Mem, FileSize, 0))
-        {
-            Mem.WriteCur = FileSize;
-        }
-        else
-        {
-            FreeMemory(&Mem);
-        }
+        ssize_t BytesWritten = write(AppendFd, Src + AmountWritten, Size - AmountWritten);
+        if (BytesWritten < 0 && errno == EINTR) continue;
+        Result = (BytesWritten > 0);
+        if (Result) AmountWritten += (usz)BytesWritten;
     }
-    return Mem;
+    close(AppendFd);
+    return Result;
 }
 
 external bool
-ReadFileAsync(file File, buffer* Dst, usz AmountToRead, usz StartPos, async* Async)
+AppendToFile(file File, buffer Content)
 {
-    if (AmountToRead <= (Dst->Size - Dst->WriteCur))
+    // The kernel finds EOF as part of each write, so appends from other threads or processes
+    // can't read the same end and overwrite each other.
+    for (usz AmountWritten = 0; AmountWritten < Content.WriteCur; )
     {
-        struct aiocb* Context = (struct aiocb*)Async->Data;
-        Context->aio_fildes = (int)File;
-        Context->aio_buf = (void*)Dst->Base;
-        Context->aio_nbytes = AmountToRead;
-        Context->aio_offset = (off_t)StartPos;
-        
-        if (aio_read(Context) == 0)
+        struct iovec Iov = { Content.Base + AmountWritten, Content.WriteCur - AmountWritten };
+        ssize_t BytesWritten = syscall(SYS_pwritev2, (int)File, &Iov, 1, 0L, 0L, RWF_APPEND);
+        if (BytesWritten < 0 && errno == EINTR) continue;
+        if (BytesWritten < 0 && errno == EOPNOTSUPP && AmountWritten == 0)
         {
-            Dst->WriteCur += AmountToRead;
-            return true;
+            return _AppendThroughProc((int)File, Content.Base, Content.WriteCur);
         }
+        if (BytesWritten <= 0) return false;
+        AmountWritten += (usz)BytesWritten;
     }
-    return false;
+    return true;
 }
 
 external bool
-AppendToFile(file File, buffer Content)
+WriteEntireFile(file File, buffer Content)
 {
-    ssize_t BytesWritten = write((int)File, Content.Base, Content.WriteCur);
-    return (BytesWritten == Content.WriteCur);
+    bool Result = _WriteToFile((int)File, Content.Base, Content.WriteCur, 0);
+    return Result;
 }
 
 external bool
-WriteEntireFile(file File, buffer Content)
+WriteToFile(file File, buffer Content, usz StartPos)
 {
-    SeekFile(File, 0);
-    bool Result = AppendToFile(File, Content);
+    bool Result = _WriteToFile((int)File, Content.Base, Content.WriteCur, StartPos);
     return Result;
 }
 
-external bool
-WriteToFile(file File, buffer Content, usz StartPos)
+#define IO_MAX_VECTORS 64
+
+internal usz
+_TransferBuffers(int Fd, buffer* Buffers, u32 Count, usz StartPos, i32 Flags, bool IsWrite)
+{
+    int RwFlags = 0;
+    if (Flags & IO_NOWAIT) RwFlags |= RWF_NOWAIT;
+    if (Flags & IO_DSYNC) RwFlags |= RWF_DSYNC;
+    
+    // [Done] is how much of the current buffer was already written; reads advance the
+    // buffers themselves.
+    usz Result = 0, Done = 0;
+    u32 Idx = 0;
+    while (Idx < Count)
+    {
+        struct iovec Iov[IO_MAX_VECTORS];
+        int NumIov = 0;
+        usz Total = 0;
+        for (u32 Next = Idx; Next < Count && NumIov < IO_MAX_VECTORS; Next++, NumIov++)
+        {
+            buffer* Buf = &Buffers[Next];
+            usz Skip = (Next == Idx) ? Done : 0;
+            u8* Ptr = (IsWrite) ? Buf->Base + Skip : Buf->Base + Buf->WriteCur;
+            usz Size = (IsWrite) ? Buf->WriteCur - Skip : Buf->Size - Buf->WriteCur;
+            Iov[NumIov].iov_base = Ptr;
+            Iov[NumIov].iov_len = Size;
+            Total += Size;
+        }
+        
+        // The offset goes split in two longs, of which the high one is unused on 64-bit.
+        long PosLow = (long)StartPos;
+        long PosHigh = (sizeof(long) == 4) ? (long)((u64)StartPos >> 32) : 0;
+        ssize_t Bytes = (IsWrite)
+            ? syscall(SYS_pwritev2, Fd, Iov, NumIov, PosLow, PosHigh, RwFlags)
+            : syscall(SYS_preadv2, Fd, Iov, NumIov, PosLow, PosHigh, RwFlags);
+        if (Bytes < 0 && errno == EINTR) continue;
+        if (Bytes < 0 && errno == EAGAIN && (Flags & IO_NOWAIT)) break;
+        if (Bytes < 0) return USZ_MAX;
+        if (Bytes == 0 && Total > 0) break;
+        
+        Result += (usz)Bytes;
+        StartPos += (usz)Bytes;
+        for (usz Left = (usz)Bytes; Idx < Count; Idx++, Done = 0)
+        {
+            buffer* Buf = &Buffers[Idx];
+            usz Available = (IsWrite) ? Buf->WriteCur - Done : Buf->Size - Buf->WriteCur;
+            usz Taken = Min(Available, Left);
+            if (IsWrite) Done += Taken;
+            else Buf->WriteCur += Taken;
+            Left -= Taken;
+            if (Taken < Available) break;
+        }
+    }
+    return Result;
+}
+
+external usz
+WriteBuffersToFile(file File, buffer* Buffers, u32 Count, usz StartPos, i32 Flags)
+{
+    usz Result = _TransferBuffers((int)File, Buffers, Count, StartPos, Flags, true);
+    return Result;
+}
+
+external usz
+ReadIntoBuffers(file File, buffer* Buffers, u32 Count, usz StartPos, i32 Flags)
 {
-    SeekFile(File, StartPos);
-    bool Result = AppendToFile(File, Content);
+    // IO_DSYNC has no meaning for reads.
+    i32 ReadFlags = Flags & IO_NOWAIT;
+    usz Result = _TransferBuffers((int)File, Buffers, Count, StartPos, ReadFlags, false);
     return Result;
 }
 
 external bool
 WriteFileAsync(file File, void* Src, usz AmountToWrite, usz StartPos, async* Async)
 {
-    struct aiocb* Context = (struct aiocb*)Async->Data;
-    Context->aio_fildes = (int)File;
-    Context->aio_buf = Src;
-    Context->aio_nbytes = AmountToWrite;
-    Context->aio_offset = (off_t)StartPos;
-    
-    bool Result = !aio_write(Context);
+    bool Result = _StartAsyncIo(File, (u8*)Src, AmountToWrite, StartPos, Async, true);
     return Result;
 }
 
 external usz
 WaitOnIoCompletion(file File, async* Async, bool Block)
 {
-    struct aiocb* Context = (struct aiocb*)Async->Data;
-    struct timespec* WaitTime = 0;
-    if (!Block)
+    _async_io* Io = (_async_io*)Async->Data;
+    if (Io->Engine == ASYNC_ENGINE_URING)
     {
-        WaitTime = (struct timespec*)&Context[1];
-        WaitTime->tv_sec = 0;
-        WaitTime->tv_nsec = 0;
+        // Completions are taken from the ring without entering the kernel, which is only
+        // asked to wait if the operation is not done yet. The ring belongs to the thread
+        // that started the IO, and is not safe to reap from any other.
+        _io_ring* Ring = &_tIoRing;
+        if (Io->Ring != Ring || Ring->State != ASYNC_ENGINE_URING) return 0;
+        _SubmitAsyncRing(Ring);
+        _ReapIoRing(Ring);
+        while (Block && Io->Pending > 0)
+        {
+            int Submitted = _EnterIoRing(Ring, Ring->Unsubmitted, 1);
+            if (Submitted < 0) break;
+            Ring->Unsubmitted -= (u32)Submitted;
+            _ReapIoRing(Ring);
+        }
+        usz Result = (Io->Pending > 0 || Io->Failed) ? 0 : Io->Transferred;
+        return Result;
     }
     
-    const struct aiocb* const CtxList[1] = { Context };
-    if (aio_suspend(CtxList, 1, WaitTime) == 0)
+    struct timespec WaitTime = {0};
+    const struct aiocb* const CtxList[1] = { &Io->Aio };
+    if (aio_suspend(CtxList, 1, (Block) ? NULL : &WaitTime) == 0)
     {
-        usz BytesTransferred = aio_return(Context);
-        return BytesTransferred;
+        ssize_t BytesTransferred = aio_return(&Io->Aio);
+        return (BytesTransferred > 0) ? (usz)BytesTransferred : 0;
     }
     
     return 0;
@@ -359,16 +1327,21 @@ FilesAreEqual(file A, file B)
     
     usz ASize = FileSizeOf(A);
     usz BSize = FileSizeOf(B);
-    if (ASize == BSize)
+    if (ASize == BSize && ASize == 0)
+    {
+        Result = true;
+    }
+    else if (ASize == BSize && ASize != USZ_MAX)
     {
-        buffer ABuf = ReadEntireFile(A);
-        buffer BBuf = ReadEntireFile(B);
+        // Mapping lets the page cache serve both files, instead of copying them in full.
+        buffer ABuf = MapFile(A, 0, ASize, MAPPED_READ|MAPPED_SEQUENTIAL);
+        buffer BBuf = MapFile(B, 0, BSize, MAPPED_READ|MAPPED_SEQUENTIAL);
         if (ABuf.Base && BBuf.Base)
         {
             Result = EqualBuffers(ABuf, BBuf);
-            FreeMemory(&ABuf);
-            FreeMemory(&BBuf);
         }
+        UnmapFile(&ABuf);
+        UnmapFile(&BBuf);
     }
     
     return Result;
@@ -418,6 +1391,318 @@ IsFileHidden(void* Filename)
     return Result;
 }
 
+//========================================
+// IO Queues
+//========================================
+
+typedef struct _io_queue_state
+{
+    _io_ring Ring;
+    io_completion* Done;
+    u32 NumDone;
+    u32 MaxDone;
+} _io_queue_state;
+
+external bool
+InitIoQueue(io_queue* Queue, u32 Entries)
+{
+    // The completions of the fallback path are kept after the state, one per entry.
+    usz Size = sizeof(_io_queue_state) + Entries * sizeof(io_completion);
+    buffer Mem = GetMemory(Size, 0, MEM_READ|MEM_WRITE);
+    if (!Mem.Base) return false;
+    
+    _io_queue_state* State = (_io_queue_state*)Mem.Base;
+    bool HasRing = _InitIoRing(&State->Ring, Entries);
+    State->Ring.State = (HasRing) ? ASYNC_ENGINE_URING : ASYNC_ENGINE_AIO;
+    State->Done = (io_completion*)&State[1];
+    State->NumDone = 0;
+    State->MaxDone = Entries;
+    Queue->State = Mem;
+    return true;
+}
+
+external void
+CloseIoQueue(io_queue* Queue)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (State->Ring.State == ASYNC_ENGINE_URING)
+    {
+        _CloseIoRing(&State->Ring);
+    }
+    FreeMemory(&Queue->State);
+}
+
+internal struct io_uring_sqe*
+_GetIoQueueSqe(_io_queue_state* State, u8 Opcode, int Fd, void* UserData)
+{
+    _io_ring* Ring = &State->Ring;
+    if (!_IoRingSpace(Ring) && (!_SubmitIoRing(Ring) || !_IoRingSpace(Ring)))
+    {
+        return NULL;
+    }
+    struct io_uring_sqe* Sqe = _PushIoRingSqe(Ring);
+    Sqe->opcode = Opcode;
+    Sqe->fd = Fd;
+    Sqe->user_data = (u64)(usz)UserData;
+    return Sqe;
+}
+
+internal void
+_PushIoQueueDone(_io_queue_state* State, isz Result, void* UserData)
+{
+    io_completion* Done = &State->Done[State->NumDone++];
+    Done->UserData = UserData;
+    Done->Result = (Result < 0) ? -errno : Result;
+}
+
+internal bool
+_QueueFileRw(io_queue* Queue, file File, void* Ptr, usz Size, usz StartPos, void* UserData,
+             bool IsWrite)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (Size > U32_MAX) return false;
+    
+    if (State->Ring.State != ASYNC_ENGINE_URING)
+    {
+        if (State->NumDone == State->MaxDone) return false;
+        isz Result = (IsWrite) ? pwrite((int)File, Ptr, Size, (off_t)StartPos)
+            : pread((int)File, Ptr, Size, (off_t)StartPos);
+        _PushIoQueueDone(State, Result, UserData);
+        return true;
+    }
+    
+    u8 Opcode = (IsWrite) ? IORING_OP_WRITE : IORING_OP_READ;
+    struct io_uring_sqe* Sqe = _GetIoQueueSqe(State, Opcode, (int)File, UserData);
+    if (!Sqe) return false;
+    Sqe->off = (u64)StartPos;
+    Sqe->addr = (u64)(usz)Ptr;
+    Sqe->len = (u32)Size;
+    _PublishIoRingSqe(&State->Ring);
+    return true;
+}
+
+external bool
+QueueFileRead(io_queue* Queue, file File, void* Dst, usz Size, usz StartPos, void* UserData)
+{
+    bool Result = _QueueFileRw(Queue, File, Dst, Size, StartPos, UserData, false);
+    return Result;
+}
+
+external bool
+QueueFileWrite(io_queue* Queue, file File, void* Src, usz Size, usz StartPos, void* UserData)
+{
+    bool Result = _QueueFileRw(Queue, File, Src, Size, StartPos, UserData, true);
+    return Result;
+}
+
+external bool
+QueueFileSync(io_queue* Queue, file File, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (State->Ring.State != ASYNC_ENGINE_URING)
+    {
+        if (State->NumDone == State->MaxDone) return false;
+        _PushIoQueueDone(State, fsync((int)File), UserData);
+        return true;
+    }
+    
+    struct io_uring_sqe* Sqe = _GetIoQueueSqe(State, IORING_OP_FSYNC, (int)File, UserData);
+    if (!Sqe) return false;
+    _PublishIoRingSqe(&State->Ring);
+    return true;
+}
+
+external bool
+QueueFileOpen(io_queue* Queue, void* Filename, i32 Flags, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (State->Ring.State != ASYNC_ENGINE_URING)
+    {
+        if (State->NumDone == State->MaxDone) return false;
+        file File = OpenFileHandle(Filename, Flags & ~HIDDEN_FILE);
+        _PushIoQueueDone(State, (isz)File, UserData);
+        return true;
+    }
+    
+    struct io_uring_sqe* Sqe = _GetIoQueueSqe(State, IORING_OP_OPENAT, AT_FDCWD, UserData);
+    if (!Sqe) return false;
+    Sqe->addr = (u64)(usz)Filename;
+    Sqe->open_flags = (u32)_GetOpenOpts(Flags, 0);
+    if (Sqe->open_flags & O_CREAT) Sqe->len = S_IRUSR|S_IWUSR;
+    _PublishIoRingSqe(&State->Ring);
+    return true;
+}
+
+external bool
+QueueFileClose(io_queue* Queue, file File, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (State->Ring.State != ASYNC_ENGINE_URING)
+    {
+        if (State->NumDone == State->MaxDone) return false;
+        _PushIoQueueDone(State, close((int)File), UserData);
+        return true;
+    }
+    
+    struct io_uring_sqe* Sqe = _GetIoQueueSqe(State, IORING_OP_CLOSE, (int)File, UserData);
+    if (!Sqe) return false;
+    _PublishIoRingSqe(&State->Ring);
+    return true;
+}
+
+external bool
+SubmitIoQueue(io_queue* Queue)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    bool Result = true;
+    if (State->Ring.State == ASYNC_ENGINE_URING)
+    {
+        Result = _SubmitIoRing(&State->Ring);
+    }
+    return Result;
+}
+
+internal u32
+_ReapIoQueue(_io_ring* Ring, io_completion* Completions, u32 MaxCount)
+{
+    _FlushIoRingOverflow(Ring);
+    u32 Head = *Ring->CqHead;
+    u32 Tail = __atomic_load_n(Ring->CqTail, __ATOMIC_ACQUIRE);
+    u32 Count = 0;
+    for (; Head != Tail && Count < MaxCount; Head++, Count++)
+    {
+        struct io_uring_cqe* Cqe = &Ring->Cqes[Head & Ring->CqMask];
+        Completions[Count].UserData = (void*)(usz)Cqe->user_data;
+        Completions[Count].Result = (isz)Cqe->res;
+    }
+    __atomic_store_n(Ring->CqHead, Head, __ATOMIC_RELEASE);
+    return Count;
+}
+
+internal usz
+_MonotonicMs(void)
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    usz Result = (usz)Now.tv_sec * 1000 + (usz)Now.tv_nsec / 1000000;
+    return Result;
+}
+
+external u32
+WaitForCompletions(io_queue* Queue, io_completion* Completions, u32 MinCount, u32 MaxCount,
+                   usz TimeoutMs)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (State->Ring.State != ASYNC_ENGINE_URING)
+    {
+        // Operations already ran when queued, so there is never anything to wait on.
+        u32 Count = Min(State->NumDone, MaxCount);
+        memcpy(Completions, State->Done, Count * sizeof(io_completion));
+        State->NumDone -= Count;
+        memmove(State->Done, State->Done + Count, State->NumDone * sizeof(io_completion));
+        return Count;
+    }
+    
+    // If the kernel refuses new entries because the completion queue is full, they go in
+    // on a later pass, after the completions are reaped into [Completions].
+    _io_ring* Ring = &State->Ring;
+    MinCount = Min(MinCount, MaxCount);
+    _SubmitIoRing(Ring);
+    u32 Result = _ReapIoQueue(Ring, Completions, MaxCount);
+    if (Ring->Unsubmitted) _SubmitIoRing(Ring);
+    
+    usz Deadline = (TimeoutMs == TIMEOUT_INFINITE) ? 0 : _MonotonicMs() + TimeoutMs;
+    while (Result < MinCount)
+    {
+        if (TimeoutMs == TIMEOUT_INFINITE)
+        {
+            int Submitted = _EnterIoRing(Ring, Ring->Unsubmitted, MinCount - Result);
+            if (Submitted < 0) break;
+            Ring->Unsubmitted -= (u32)Submitted;
+        }
+        else
+        {
+            // The ring is pollable, which gives a timed wait on kernels that can't pass a
+            // timeout to io_uring_enter().
+            usz Now = _MonotonicMs();
+            if (Now >= Deadline) break;
+            struct pollfd Poll = { Ring->Fd, POLLIN, 0 };
+            if (poll(&Poll, 1, (int)Min(Deadline - Now, I32_MAX)) < 0 && errno != EINTR) break;
+        }
+        Result += _ReapIoQueue(Ring, Completions + Result, MaxCount - Result);
+        if (Ring->Unsubmitted) _SubmitIoRing(Ring);
+    }
+    return Result;
+}
+
+
+//========================================
+// File Mapping
+//========================================
+
+internal usz
+_GetMapAlignment(void)
+{
+    usz Result = (gSysInfo.MemBlockSize) ? gSysInfo.MemBlockSize : 4096;
+    return Result;
+}
+
+external buffer
+MapFile(file File, usz Offset, usz Size, i32 Flags)
+{
+    buffer Result = {0};
+    if (!Size)
+    {
+        usz FileSize = FileSizeOf(File);
+        if (FileSize == USZ_MAX || FileSize <= Offset) return Result;
+        Size = FileSize - Offset;
+    }
+    
+    // The mapping has to start at a page boundary, so it begins a bit before [Offset].
+    usz Start = Offset - (Offset % _GetMapAlignment());
+    usz Lead = Offset - Start;
+    int Prot = (Flags & (MAPPED_WRITE|MAPPED_COPY)) ? PROT_READ|PROT_WRITE : PROT_READ;
+    int MapFlags = (Flags & MAPPED_COPY) ? MAP_PRIVATE : MAP_SHARED;
+    if (Flags & MAPPED_POPULATE) MapFlags |= MAP_POPULATE;
+    
+    u8* Base = (u8*)mmap(NULL, Size + Lead, Prot, MapFlags, (int)File, (off_t)Start);
+    if (Base == MAP_FAILED) return Result;
+    
+    if (Flags & MAPPED_SEQUENTIAL) madvise(Base, Size + Lead, MADV_SEQUENTIAL);
+    else if (Flags & MAPPED_RANDOM) madvise(Base, Size + Lead, MADV_RANDOM);
+    if (Flags & MAPPED_WILLNEED) madvise(Base, Size + Lead, MADV_WILLNEED);
+    
+    Result = Buffer(Base + Lead, Size, Size);
+    return Result;
+}
+
+external buffer
+MapEntireFile(file File, i32 Flags)
+{
+    buffer Result = MapFile(File, 0, 0, Flags);
+    return Result;
+}
+
+external void
+UnmapFile(buffer* Map)
+{
+    if (Map->Base)
+    {
+        usz Lead = (usz)Map->Base % _GetMapAlignment();
+        munmap(Map->Base - Lead, Map->Size + Lead);
+    }
+    memset(Map, 0, sizeof(buffer));
+}
+
+external bool
+FlushMappedRange(void* Start, usz Size)
+{
+    usz Lead = (usz)Start % _GetMapAlignment();
+    int Result = msync((u8*)Start - Lead, Size + Lead, MS_SYNC);
+    return (Result == 0);
+}
+
+
 //========================================
 // Filesystem
 //========================================
@@ -796,43 +2081,140 @@ UnloadExternalLibrary(file Library)
 // Threading
 //========================================
 
-// TODO: Change method for getting tid to something more reliable.
-internal pid_t
-_GetThreadID(file ThreadHandle)
+typedef struct _thread_start
+{
+    thread_proc Proc;
+    void* Arg;
+    const char* Name;
+    u64 Affinity;
+    i32 Node;
+    u32 ID;
+    u32 Ready;
+} _thread_start;
+
+internal bool
+_SetAffinity(u64 Affinity)
+{
+    // The kernel wants a mask at least as big as the number of CPUs it supports.
+    u64 Mask[16] = {0};
+    Mask[0] = Affinity;
+    bool Result = (syscall(SYS_sched_setaffinity, 0, sizeof(Mask), Mask) == 0);
+    return Result;
+}
+
+internal u64
+_GetNodeAffinity(i32 Node)
 {
-    // This struct is only to cast pthread_t and get the tid.
-    struct _pthread_hack_
+    u64 Result = 0;
+    for (usz Cpu = 0; Cpu < 64; Cpu++)
     {
-        u8 _Padding[720];
-        pid_t ThreadID;
-    };
+        if (_IsCpuOnline(Cpu) && gSysInfo.Cpus[Cpu].Node == Node) Result |= 1ULL << Cpu;
+    }
+    return Result;
+}
+
+internal void*
+_ThreadStart(void* Arg)
+{
+    _thread_start* Start = (_thread_start*)Arg;
+    thread_proc Proc = Start->Proc;
+    void* ProcArg = Start->Arg;
     
-    struct _pthread_hack_* PThread = (struct _pthread_hack_*)ThreadHandle;
-    pid_t TID = PThread->ThreadID;
+    if (Start->Affinity && !_SetAffinity(Start->Affinity))
+    {
+        // The thread would run on the wrong CPUs, so it quits before calling [Proc] and lets
+        // the creator report the failure.
+        __atomic_store_n(&Start->Ready, 2, __ATOMIC_RELEASE);
+        WakeFutex(&Start->Ready, false);
+        return NULL;
+    }
+    if (Start->Node != THREAD_ANY_NODE)
+    {
+        SetThreadMemoryNode(Start->Node);
+    }
+    if (Start->Name)
+    {
+        char Name[16] = {0};
+        for (usz Idx = 0; Idx < sizeof(Name)-1 && Start->Name[Idx]; Idx++)
+        {
+            Name[Idx] = Start->Name[Idx];
+        }
+        prctl(PR_SET_NAME, Name, 0, 0, 0);
+    }
+    Start->ID = GetThreadID();
     
-    return TID;
+    // [Start] lives in the creating thread's stack, and is gone as soon as it sees this.
+    __atomic_store_n(&Start->Ready, 1, __ATOMIC_RELEASE);
+    WakeFutex(&Start->Ready, false);
+    return Proc(ProcArg);
 }
 
 external thread
 InitThread(thread_proc ThreadProc, void* ThreadArg, bool Waitable)
+{
+    thread_options Options = DEFAULT_THREAD_OPTIONS;
+    Options.Waitable = Waitable;
+    thread Result = InitThreadEx(ThreadProc, ThreadArg, &Options);
+    return Result;
+}
+
+external thread
+InitThreadEx(thread_proc ThreadProc, void* ThreadArg, thread_options* Options)
 {
     thread Result = {0};
     
-    int Detach = (Waitable) ? PTHREAD_CREATE_JOINABLE : PTHREAD_CREATE_DETACHED;
-    pthread_attr_t Attr = {0};
+    _thread_start Start = { ThreadProc, ThreadArg, Options->Name, Options->Affinity,
+        Options->Node, 0, 0 };
+    if (!Start.Affinity && Options->Node != THREAD_ANY_NODE)
+    {
+        Start.Affinity = _GetNodeAffinity(Options->Node);
+    }
+    usz StackSize = (Options->StackSize) ? Options->StackSize : Megabyte(2);
+    
+    int Detach = (Options->Waitable) ? PTHREAD_CREATE_JOINABLE : PTHREAD_CREATE_DETACHED;
+    pthread_attr_t Attr;
     pthread_t Thread = 0;
-    if (!pthread_attr_init(&Attr)
-        && !pthread_attr_setdetachstate(&Attr, Detach)
-        && !pthread_attr_setguardsize(&Attr, gSysInfo.PageSize)
-        && !pthread_attr_setstacksize(&Attr, Megabyte(2))
-        && !pthread_create(&Thread, &Attr, ThreadProc, ThreadArg))
+    if (!pthread_attr_init(&Attr))
     {
-        Result.Handle = (file)Thread;
+        if (!pthread_attr_setdetachstate(&Attr, Detach)
+            && !pthread_attr_setguardsize(&Attr, gSysInfo.PageSize)
+            && !pthread_attr_setstacksize(&Attr, Max(StackSize, Kilobyte(16)))
+            && !pthread_create(&Thread, &Attr, _ThreadStart, &Start))
+        {
+            while (!__atomic_load_n(&Start.Ready, __ATOMIC_ACQUIRE))
+            {
+                WaitOnFutex(&Start.Ready, 0, TIMEOUT_INFINITE);
+            }
+            if (Start.Ready == 1)
+            {
+                Result.Handle = (file)Thread;
+                Result.ID = Start.ID;
+            }
+            else if (Options->Waitable)
+            {
+                pthread_join(Thread, NULL);
+            }
+        }
+        pthread_attr_destroy(&Attr);
     }
     
     return Result;
 }
 
+external bool
+SetThreadAffinity(u64 Affinity)
+{
+    bool Result = _SetAffinity(Affinity);
+    return Result;
+}
+
+external u32
+GetThreadID(void)
+{
+    u32 Result = (u32)syscall(SYS_gettid);
+    return Result;
+}
+
 external bool
 ChangeThreadScheduling(thread* Thread, int NewScheduling)
 {
@@ -843,14 +2225,14 @@ ChangeThreadScheduling(thread* Thread, int NewScheduling)
         case SCHEDULE_LOW: Priority = 19; break;
         default: Priority = 0;
     }
-    int Error = setpriority(PRIO_PROCESS, _GetThreadID(Thread->Handle), Priority);
+    int Error = setpriority(PRIO_PROCESS, Thread->ID, Priority);
     return !Error;
 }
 
 external i32
 GetThreadScheduling(thread Thread)
 {
-    int Priority = getpriority(PRIO_PROCESS, _GetThreadID(Thread.Handle));
+    int Priority = getpriority(PRIO_PROCESS, Thread.ID);
     i32 Result = (Priority >= 7) ? SCHEDULE_LOW : (Priority < -7) ? SCHEDULE_HIGH : SCHEDULE_NORMAL;
     return Result;
 }
@@ -888,33 +2270,32 @@ KillThread(thread* Thread)
 // Synchronization
 //========================================
 
-external mutex
-InitMutex(void)
+// Atomics for the locks in tinybase-platform-common.c. Read-modify-writes are
+// acquire-release, which serves both taking and releasing a lock.
+
+internal u32
+_SyncLoad(u32* Src)
 {
-    mutex Result = {0};
-    pthread_mutex_init((pthread_mutex_t*)Result.Handle, NULL);
-    return Result;
+    return __atomic_load_n(Src, __ATOMIC_RELAXED);
 }
 
-external bool
-CloseMutex(mutex* Mutex)
+internal u32
+_SyncExchange(u32* Dst, u32 Value)
 {
-    int Result = pthread_mutex_destroy((pthread_mutex_t*)Mutex->Handle);
-    return (Result == 0);
+    return __atomic_exchange_n(Dst, Value, __ATOMIC_ACQ_REL);
 }
 
-external bool
-LockOnMutex(mutex* Mutex)
+internal bool
+_SyncCompareExchange(u32* Dst, u32* Expected, u32 Value)
 {
-    int Result = pthread_mutex_lock((pthread_mutex_t*)Mutex->Handle);
-    return (Result == 0);
+    return __atomic_compare_exchange_n(Dst, Expected, Value, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
 }
 
-external bool
-UnlockMutex(mutex* Mutex)
+internal u32
+_SyncAddFetch(u32* Dst, u32 Value)
 {
-    int Result = pthread_mutex_unlock((pthread_mutex_t*)Mutex->Handle);
-    return (Result == 0);
+    return __atomic_add_fetch(Dst, Value, __ATOMIC_ACQ_REL);
 }
 
 external semaphore
@@ -945,3 +2326,25 @@ WaitOnSemaphore(semaphore* Semaphore)
     int Result = sem_wait((sem_t*)Semaphore->Handle);
     return Result;
 }
+
+internal bool
+_FutexWait(void* Address, i32 Expected, usz TimeoutMs)
+{
+    struct timespec Timeout = {0}, *TimeoutPtr = NULL;
+    if (TimeoutMs != TIMEOUT_INFINITE)
+    {
+        Timeout.tv_sec = TimeoutMs / 1000;
+        Timeout.tv_nsec = (TimeoutMs % 1000) * 1000000;
+        TimeoutPtr = &Timeout;
+    }
+    
+    long Result = syscall(SYS_futex, Address, FUTEX_WAIT_PRIVATE, Expected, TimeoutPtr, NULL, 0);
+    return (Result == 0 || errno != ETIMEDOUT);
+}
+
+internal bool
+_FutexWake(void* Address, bool WakeAll)
+{
+    long Result = syscall(SYS_futex, Address, FUTEX_WAKE_PRIVATE, WakeAll ? I32_MAX : 1, NULL, NULL, 0);
+    return (Result != -1);
+}
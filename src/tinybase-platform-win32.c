@@ -6,6 +6,7 @@
 
 #pragma comment(lib, "kernel32")
 #pragma comment(lib, "ntdll")
+#pragma comment(lib, "synchronization")
 
 #define _RECURSIVE_
 
@@ -13,6 +14,87 @@
 // Config
 //========================================
 
+internal void
+_LoadCpuTopology(void)
+{
+    // CPUs are numbered across processor groups, so that group 1 carries on after the last
+    // CPU of group 0, and so on (each group holds up to 64 of them).
+    usz GroupStart[MAX_CPU_INFO/64 + 1] = {0};
+    WORD NumGroups = (WORD)Min(GetActiveProcessorGroupCount(), ArrayCount(GroupStart) - 1);
+    for (WORD Group = 0; Group < NumGroups; Group++)
+    {
+        GroupStart[Group+1] = GroupStart[Group] + GetActiveProcessorCount(Group);
+    }
+    
+    DWORD Size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, NULL, &Size);
+    buffer Mem = GetMemoryFromHeap(Size);
+    if (!Mem.Base) return;
+    
+    gSysInfo.NumCores = 0;
+    gSysInfo.NumNodes = 1;
+    if (GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)Mem.Base,
+                                         &Size))
+    {
+        u16 NumPackages = 0;
+        for (DWORD Offset = 0; Offset < Size;)
+        {
+            PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX Info =
+                (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(Mem.Base + Offset);
+            Offset += Info->Size;
+            
+            if (Info->Relationship == RelationProcessorCore)
+            {
+                // A core is in a single group, and so are its hyperthreads.
+                WORD Group = Info->Processor.GroupMask[0].Group;
+                KAFFINITY Mask = Info->Processor.GroupMask[0].Mask;
+                for (u16 Sibling = 0; Group < NumGroups && Mask; Sibling++, Mask &= Mask - 1)
+                {
+                    usz Cpu = GroupStart[Group] + GetFirstBitSet64(Mask);
+                    if (Cpu >= MAX_CPU_INFO) break;
+                    gSysInfo.Cpus[Cpu].Core = (u16)gSysInfo.NumCores;
+                    gSysInfo.Cpus[Cpu].Sibling = Sibling;
+                }
+                gSysInfo.NumCores++;
+            }
+            else if (Info->Relationship == RelationProcessorPackage)
+            {
+                for (WORD Idx = 0; Idx < Info->Processor.GroupCount; Idx++)
+                {
+                    WORD Group = Info->Processor.GroupMask[Idx].Group;
+                    KAFFINITY Mask = Info->Processor.GroupMask[Idx].Mask;
+                    for (; Group < NumGroups && Mask; Mask &= Mask - 1)
+                    {
+                        usz Cpu = GroupStart[Group] + GetFirstBitSet64(Mask);
+                        if (Cpu < MAX_CPU_INFO) gSysInfo.Cpus[Cpu].Package = NumPackages;
+                    }
+                }
+                NumPackages++;
+            }
+            else if (Info->Relationship == RelationNumaNode)
+            {
+                u16 Node = (u16)Info->NumaNode.NodeNumber;
+                WORD Group = Info->NumaNode.GroupMask.Group;
+                for (KAFFINITY Mask = Info->NumaNode.GroupMask.Mask; Group < NumGroups && Mask;
+                     Mask &= Mask - 1)
+                {
+                    usz Cpu = GroupStart[Group] + GetFirstBitSet64(Mask);
+                    if (Cpu < MAX_CPU_INFO) gSysInfo.Cpus[Cpu].Node = Node;
+                }
+                gSysInfo.NumNodes = Max(gSysInfo.NumNodes, (usz)Node + 1);
+            }
+            else if (Info->Relationship == RelationCache
+                     && (Info->Cache.GroupMask.Mask & 1) && Info->Cache.GroupMask.Group == 0
+                     && Info->Cache.Level >= 1 && Info->Cache.Level <= 3
+                     && Info->Cache.Type != CacheInstruction)
+            {
+                gSysInfo.CacheSizes[Info->Cache.Level-1] = Info->Cache.CacheSize;
+            }
+        }
+    }
+    FreeMemoryFromHeap(&Mem);
+}
+
 external void
 LoadSystemInfo(void)
 {
@@ -22,7 +104,9 @@ LoadSystemInfo(void)
     gSysInfo.AddressRange[0] = (isz)Info.lpMinimumApplicationAddress;
     gSysInfo.AddressRange[1] = (isz)Info.lpMaximumApplicationAddress;
     gSysInfo.MemBlockSize = Info.dwAllocationGranularity;
-    gSysInfo.NumThreads = Info.dwNumberOfProcessors;
+    gSysInfo.NumThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    gSysInfo.HugePageSizes[0] = GetLargePageMinimum();
+    _LoadCpuTopology();
     
     LARGE_INTEGER Freq;
     QueryPerformanceFrequency(&Freq);
@@ -62,11 +146,9 @@ ClearMemory(buffer* Mem)
     Mem->WriteCur = 0;
 }
 
-external buffer
-GetMemory(usz Size, void* Address, int Flags)
+internal DWORD
+_GetMemoryAccess(int Flags)
 {
-    buffer Result = {0};
-    
     DWORD Access = 0;
     if (Flags & MEM_GUARD)
     {
@@ -86,19 +168,167 @@ GetMemory(usz Size, void* Address, int Flags)
     {
         Access = PAGE_READONLY;
     }
+    return Access;
+}
+
+internal void
+_PrefaultMemory(void* Address, usz Size, int Flags)
+{
+    // Touches one byte of each page, so the system maps them all in now.
+    usz PageSize = (gSysInfo.PageSize) ? gSysInfo.PageSize : 4096;
+    for (usz Offset = 0; Offset < Size; Offset += PageSize)
+    {
+        volatile u8* Byte = (volatile u8*)Address + Offset;
+        if (Flags & MEM_WRITE) *Byte = *Byte;
+        else (void)*Byte;
+    }
+}
+
+internal bool
+_LockMemory(buffer* Mem, int Flags)
+{
+    if (Mem->Base && (Flags & MEM_LOCK) && !VirtualLock(Mem->Base, Mem->Size))
+    {
+        FreeMemory(Mem);
+        return false;
+    }
+    return Mem->Base != NULL;
+}
+
+external buffer
+GetHugePageMemory(usz Size, void* Address, int Flags, i32* Kind)
+{
+    buffer Result = {0};
+    i32 Got = HUGEPAGE_NONE;
+    DWORD Access = _GetMemoryAccess(Flags);
+    
+    // Large pages need SeLockMemoryPrivilege, and a size that is a multiple of their own.
+    usz PageSize = gSysInfo.HugePageSizes[0];
+    if (PageSize)
+    {
+        usz HugeSize = Align(Size, PageSize);
+        void* Ptr = VirtualAlloc(Address, HugeSize, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, Access);
+        if (Ptr)
+        {
+            Result.Base = (u8*)Ptr;
+            Result.Size = HugeSize;
+            Got = HUGEPAGE_EXPLICIT;
+        }
+    }
     
-    DWORD HugePages = ((Flags & MEM_HUGEPAGE) > 0) ? MEM_LARGE_PAGES : 0;
-    DWORD AllocType = MEM_RESERVE | MEM_COMMIT | HugePages;
+    if (!Result.Base)
+    {
+        // Still rounded up to the large page size, so that the size doesn't depend on
+        // whether the privilege is held.
+        usz Boundary = (PageSize) ? PageSize : gSysInfo.PageSize;
+        usz FallbackSize = Align(Size, Boundary);
+        void* Ptr = VirtualAlloc(Address, FallbackSize, MEM_RESERVE|MEM_COMMIT, Access);
+        if (Ptr)
+        {
+            Result.Base = (u8*)Ptr;
+            Result.Size = FallbackSize;
+            if (Flags & MEM_PREFAULT) _PrefaultMemory(Result.Base, Result.Size, Flags);
+        }
+    }
     
-    void* Ptr = VirtualAlloc(Address, Size, AllocType, Access);
+    // The block is freed if it can't be locked, and then there are no pages of any kind.
+    if (!_LockMemory(&Result, Flags)) Got = HUGEPAGE_NONE;
+    if (Kind) *Kind = Got;
+    return Result;
+}
+
+external buffer
+GetMemory(usz Size, void* Address, int Flags)
+{
+    if (Flags & (MEM_HUGEPAGE|MEM_HUGEPAGE_1GB))
+    {
+        return GetHugePageMemory(Size, Address, Flags, NULL);
+    }
+    
+    buffer Result = {0};
+    DWORD Access = _GetMemoryAccess(Flags);
+    void* Ptr = VirtualAlloc(Address, Size, MEM_RESERVE|MEM_COMMIT, Access);
     if (Ptr)
     {
         Result.Base = (u8*)Ptr;
         Result.Size = (gSysInfo.PageSize) ? Align(Size, gSysInfo.PageSize) : Size;
+        if (Flags & MEM_PREFAULT) _PrefaultMemory(Result.Base, Result.Size, Flags);
+        _LockMemory(&Result, Flags);
     }
     return Result;
 }
 
+external buffer
+GetMemoryOnNode(usz Size, i32 Node, int Flags)
+{
+    buffer Result = {0};
+    if (Node < 0) return Result;
+    
+    void* Ptr = VirtualAllocExNuma(GetCurrentProcess(), NULL, Size, MEM_RESERVE|MEM_COMMIT,
+                                   _GetMemoryAccess(Flags), (DWORD)Node);
+    if (Ptr)
+    {
+        Result.Base = (u8*)Ptr;
+        Result.Size = (gSysInfo.PageSize) ? Align(Size, gSysInfo.PageSize) : Size;
+        if (Flags & MEM_PREFAULT) _PrefaultMemory(Result.Base, Result.Size, Flags);
+        _LockMemory(&Result, Flags);
+    }
+    return Result;
+}
+
+external bool
+SetThreadMemoryNode(i32 Node)
+{
+    // The system allocates from the node of the thread's ideal processor, so pointing that
+    // at the node is a preference, like MPOL_PREFERRED, and leaves the affinity alone. There
+    // is no default to go back to, so -1 keeps the current one.
+    if (Node < 0) return true;
+    
+    GROUP_AFFINITY Affinity;
+    if (!GetNumaNodeProcessorMaskEx((USHORT)Node, &Affinity) || !Affinity.Mask) return false;
+    PROCESSOR_NUMBER Ideal = {0};
+    Ideal.Group = Affinity.Group;
+    Ideal.Number = (BYTE)GetFirstBitSet64(Affinity.Mask);
+    return SetThreadIdealProcessorEx(GetCurrentThread(), &Ideal, NULL) != 0;
+}
+
+external buffer
+ReserveMemory(usz Size, void* Address)
+{
+    buffer Result = {0};
+    void* Ptr = VirtualAlloc(Address, Size, MEM_RESERVE, PAGE_NOACCESS);
+    if (Ptr)
+    {
+        Result.Base = (u8*)Ptr;
+        Result.Size = (gSysInfo.PageSize) ? Align(Size, gSysInfo.PageSize) : Size;
+    }
+    return Result;
+}
+
+external bool
+CommitMemory(void* Address, usz Size, int Flags)
+{
+    if (!VirtualAlloc(Address, Size, MEM_COMMIT, _GetMemoryAccess(Flags))) return false;
+    if (Flags & MEM_PREFAULT) _PrefaultMemory(Address, Size, Flags);
+    if ((Flags & MEM_LOCK) && !VirtualLock(Address, Size)) return false;
+    return true;
+}
+
+external bool
+DecommitMemory(void* Address, usz Size)
+{
+    bool Result = VirtualFree(Address, Size, MEM_DECOMMIT);
+    return Result;
+}
+
+external bool
+ProtectMemory(void* Address, usz Size, int Flags)
+{
+    DWORD OldAccess;
+    bool Result = VirtualProtect(Address, Size, _GetMemoryAccess(Flags), &OldAccess);
+    return Result;
+}
+
 external void
 FreeMemory(buffer* Mem)
 {
@@ -163,7 +393,9 @@ CreateNewFile(void* Filename, i32 Flags)
 external file
 OpenFileHandle(void* Filename, i32 Flags)
 {
-    DWORD CreationMode = (Flags & FORCE_OPEN) ? OPEN_ALWAYS : OPEN_EXISTING;
+    DWORD CreationMode = OPEN_EXISTING;
+    if (Flags & FORCE_OPEN) CreationMode = (Flags & FORCE_CREATE) ? CREATE_ALWAYS : OPEN_ALWAYS;
+    else if (Flags & FORCE_CREATE) CreationMode = TRUNCATE_EXISTING;
     file Result = _NewFile(Filename, CreationMode, Flags);
     return Result;
 }
@@ -214,28 +446,30 @@ SeekFile(file File, usz Pos)
 external bool
 ReadFromFile(file File, buffer* Dst, usz AmountToRead, usz StartPos)
 {
-    usz FileSize = FileSizeOf(File);
-    if ((StartPos + AmountToRead) <= FileSize
-        && AmountToRead <= (Dst->Size - Dst->WriteCur))
+    if (AmountToRead > (Dst->Size - Dst->WriteCur))
     {
-        SeekFile(File, StartPos);
-        usz RemainsToRead = AmountToRead;
-        u8* Ptr = Dst->Base + Dst->WriteCur;
-        while (RemainsToRead > 0)
+        return false;
+    }
+    
+    // Passing the offset in an OVERLAPPED makes each read positional, so there is no
+    // separate seek for other threads to race with.
+    u8* Ptr = Dst->Base + Dst->WriteCur;
+    for (usz AmountRead = 0; AmountRead < AmountToRead; )
+    {
+        OVERLAPPED Overlapped = {0};
+        Overlapped.Offset = (StartPos + AmountRead) & 0xFFFFFFFF;
+        Overlapped.OffsetHigh = ((StartPos + AmountRead) >> 32) & 0xFFFFFFFF;
+        DWORD ReadSize = (DWORD)Min(AmountToRead - AmountRead, U32_MAX);
+        DWORD BytesRead = 0;
+        if (!ReadFile((HANDLE)File, Ptr + AmountRead, ReadSize, &BytesRead, &Overlapped)
+            || BytesRead == 0)
         {
-            DWORD ReadSize = (RemainsToRead > U32_MAX) ? U32_MAX : (DWORD)RemainsToRead;
-            DWORD BytesRead = 0;
-            if (!ReadFile((HANDLE)File, Ptr, ReadSize, &BytesRead, NULL))
-            {
-                return false;
-            }
-            RemainsToRead -= BytesRead;
-            Ptr += BytesRead;
+            return false;
         }
-        Dst->WriteCur += AmountToRead;
-        return true;
+        AmountRead += BytesRead;
     }
-    return false;
+    Dst->WriteCur += AmountToRead;
+    return true;
 }
 
 external buffer
@@ -285,38 +519,98 @@ ReadFileAsync(file File, buffer* Dst, usz AmountToRead, usz StartPos, async* Asy
     return false;
 }
 
-external bool
-AppendToFile(file File, buffer Content)
+internal bool
+_WriteToFile(HANDLE File, u8* Src, usz Size, usz StartPos)
 {
-    usz RemainsToWrite = Content.WriteCur;
-    u8* Ptr = Content.Base;
-    while (RemainsToWrite > 0)
+    // An offset of USZ_MAX (all bits set) makes Windows write at EOF.
+    for (usz AmountWritten = 0; AmountWritten < Size; )
     {
-        DWORD WriteSize = (DWORD)Min(RemainsToWrite, U32_MAX);
+        usz Pos = (StartPos == USZ_MAX) ? USZ_MAX : StartPos + AmountWritten;
+        OVERLAPPED Overlapped = {0};
+        Overlapped.Offset = Pos & 0xFFFFFFFF;
+        Overlapped.OffsetHigh = (Pos >> 32) & 0xFFFFFFFF;
+        DWORD WriteSize = (DWORD)Min(Size - AmountWritten, U32_MAX);
         DWORD BytesWritten = 0;
-        if (!WriteFile((HANDLE)File, Ptr, WriteSize, &BytesWritten, NULL))
+        if (!WriteFile(File, Src + AmountWritten, WriteSize, &BytesWritten, &Overlapped)
+            || BytesWritten == 0)
         {
             return false;
         }
-        RemainsToWrite -= BytesWritten;
-        Ptr += BytesWritten;
+        AmountWritten += BytesWritten;
     }
     return true;
 }
 
+external bool
+AppendToFile(file File, buffer Content)
+{
+    bool Result = _WriteToFile((HANDLE)File, Content.Base, Content.WriteCur, USZ_MAX);
+    return Result;
+}
+
 external bool
 WriteEntireFile(file File, buffer Content)
 {
-    SeekFile(File, 0);
-    bool Result = AppendToFile(File, Content);
+    bool Result = _WriteToFile((HANDLE)File, Content.Base, Content.WriteCur, 0);
     return Result;
 }
 
 external bool
 WriteToFile(file File, buffer Content, usz StartPos)
 {
-    SeekFile(File, StartPos);
-    bool Result = AppendToFile(File, Content);
+    bool Result = _WriteToFile((HANDLE)File, Content.Base, Content.WriteCur, StartPos);
+    return Result;
+}
+
+external usz
+WriteBuffersToFile(file File, buffer* Buffers, u32 Count, usz StartPos, i32 Flags)
+{
+    // Windows only does scatter/gather IO with unbuffered, page-sized buffers, so each
+    // buffer gets a write of its own.
+    usz Result = 0;
+    for (u32 Idx = 0; Idx < Count; Idx++)
+    {
+        buffer* Buf = &Buffers[Idx];
+        if (!_WriteToFile((HANDLE)File, Buf->Base, Buf->WriteCur, StartPos + Result))
+        {
+            return USZ_MAX;
+        }
+        Result += Buf->WriteCur;
+    }
+    if ((Flags & IO_DSYNC) && !FlushFileBuffers((HANDLE)File))
+    {
+        return USZ_MAX;
+    }
+    return Result;
+}
+
+external usz
+ReadIntoBuffers(file File, buffer* Buffers, u32 Count, usz StartPos, i32 Flags)
+{
+    usz Result = 0;
+    for (u32 Idx = 0; Idx < Count; Idx++)
+    {
+        buffer* Buf = &Buffers[Idx];
+        while (Buf->WriteCur < Buf->Size)
+        {
+            OVERLAPPED Overlapped = {0};
+            Overlapped.Offset = (StartPos + Result) & 0xFFFFFFFF;
+            Overlapped.OffsetHigh = ((StartPos + Result) >> 32) & 0xFFFFFFFF;
+            DWORD ReadSize = (DWORD)Min(Buf->Size - Buf->WriteCur, U32_MAX);
+            DWORD BytesRead = 0;
+            if (!ReadFile((HANDLE)File, Buf->Base + Buf->WriteCur, ReadSize, &BytesRead,
+                          &Overlapped))
+            {
+                return (GetLastError() == ERROR_HANDLE_EOF) ? Result : USZ_MAX;
+            }
+            if (BytesRead == 0)
+            {
+                return Result;
+            }
+            Buf->WriteCur += BytesRead;
+            Result += BytesRead;
+        }
+    }
     return Result;
 }
 
@@ -355,6 +649,35 @@ WaitOnIoCompletion(file File, async* Async, bool Block)
     return BytesTransferred;
 }
 
+external void
+BeginIoBatch(void)
+{
+    // Overlapped IO is handed to the kernel by the call that starts it.
+}
+
+external bool
+EndIoBatch(void)
+{
+    return true;
+}
+
+external bool
+RegisterIoBuffers(buffer* Buffers, u32 Count)
+{
+    return true;
+}
+
+external bool
+RegisterIoFiles(file* Files, u32 Count)
+{
+    return true;
+}
+
+external void
+CloseAsyncIo(void)
+{
+}
+
 external usz
 FileLastWriteTime(file File)
 {
@@ -374,16 +697,21 @@ FilesAreEqual(file A, file B)
     
     usz ASize = FileSizeOf(A);
     usz BSize = FileSizeOf(B);
-    if (ASize == BSize)
+    if (ASize == BSize && ASize == 0)
     {
-        buffer ABuf = ReadEntireFile(A);
-        buffer BBuf = ReadEntireFile(B);
+        Result = true;
+    }
+    else if (ASize == BSize && ASize != USZ_MAX)
+    {
+        // Mapping lets the page cache serve both files, instead of copying them in full.
+        buffer ABuf = MapFile(A, 0, ASize, MAPPED_READ|MAPPED_SEQUENTIAL);
+        buffer BBuf = MapFile(B, 0, BSize, MAPPED_READ|MAPPED_SEQUENTIAL);
         if (ABuf.Base && BBuf.Base)
         {
             Result = EqualBuffers(ABuf, BBuf);
-            FreeMemory(&ABuf);
-            FreeMemory(&BBuf);
         }
+        UnmapFile(&ABuf);
+        UnmapFile(&BBuf);
     }
     
     return Result;
@@ -410,6 +738,303 @@ IsFileHidden(void* Filename)
     return (Result & FILE_ATTRIBUTE_HIDDEN);
 }
 
+//========================================
+// IO Queues
+//========================================
+
+#define IO_QUEUE_REAP_BATCH 64
+#define IO_STATUS_END_OF_FILE 0xC0000011 // STATUS_END_OF_FILE, from ntstatus.h.
+
+typedef struct _io_op
+{
+    OVERLAPPED Overlapped;
+    void* UserData;
+    isz Result;
+    bool Posted;
+    struct _io_op* Next;
+} _io_op;
+
+typedef struct _io_queue_state
+{
+    HANDLE Port;
+    _io_op* FreeOps;
+} _io_queue_state;
+
+external bool
+InitIoQueue(io_queue* Queue, u32 Entries)
+{
+    // Each operation in flight needs an OVERLAPPED of its own, kept after the state.
+    usz Size = sizeof(_io_queue_state) + Entries * sizeof(_io_op);
+    buffer Mem = GetMemory(Size, 0, MEM_READ|MEM_WRITE);
+    if (!Mem.Base) return false;
+    
+    _io_queue_state* State = (_io_queue_state*)Mem.Base;
+    State->Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (!State->Port)
+    {
+        FreeMemory(&Mem);
+        return false;
+    }
+    
+    _io_op* Ops = (_io_op*)&State[1];
+    State->FreeOps = NULL;
+    for (u32 Idx = Entries; Idx > 0; Idx--)
+    {
+        Ops[Idx-1].Next = State->FreeOps;
+        State->FreeOps = &Ops[Idx-1];
+    }
+    Queue->State = Mem;
+    return true;
+}
+
+external void
+CloseIoQueue(io_queue* Queue)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    CloseHandle(State->Port);
+    FreeMemory(&Queue->State);
+}
+
+internal _io_op*
+_GetIoOp(_io_queue_state* State, void* UserData)
+{
+    _io_op* Op = State->FreeOps;
+    if (Op)
+    {
+        State->FreeOps = Op->Next;
+        memset(&Op->Overlapped, 0, sizeof(OVERLAPPED));
+        Op->UserData = UserData;
+        Op->Posted = false;
+    }
+    return Op;
+}
+
+internal bool
+_PostIoOp(_io_queue_state* State, _io_op* Op, isz Result)
+{
+    // Used for operations that don't go through the port (or failed to start), which
+    // are done on the spot and only have their completion queued.
+    Op->Result = Result;
+    Op->Posted = true;
+    if (!PostQueuedCompletionStatus(State->Port, 0, 0, &Op->Overlapped))
+    {
+        Op->Next = State->FreeOps;
+        State->FreeOps = Op;
+        return false;
+    }
+    return true;
+}
+
+internal bool
+_QueueFileRw(io_queue* Queue, file File, void* Ptr, usz Size, usz StartPos, void* UserData,
+             bool IsWrite)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    if (Size > U32_MAX) return false;
+    
+    _io_op* Op = _GetIoOp(State, UserData);
+    if (!Op) return false;
+    
+    // Binding a handle a second time fails, which is harmless.
+    CreateIoCompletionPort((HANDLE)File, State->Port, 0, 0);
+    Op->Overlapped.Offset = StartPos & 0xFFFFFFFF;
+    Op->Overlapped.OffsetHigh = (StartPos >> 32) & 0xFFFFFFFF;
+    BOOL Started = (IsWrite)
+        ? WriteFile((HANDLE)File, Ptr, (DWORD)Size, NULL, &Op->Overlapped)
+        : ReadFile((HANDLE)File, Ptr, (DWORD)Size, NULL, &Op->Overlapped);
+    if (!Started)
+    {
+        DWORD Error = GetLastError();
+        if (Error == ERROR_HANDLE_EOF) return _PostIoOp(State, Op, 0);
+        else if (Error != ERROR_IO_PENDING) return _PostIoOp(State, Op, -(isz)Error);
+    }
+    return true;
+}
+
+external bool
+QueueFileRead(io_queue* Queue, file File, void* Dst, usz Size, usz StartPos, void* UserData)
+{
+    bool Result = _QueueFileRw(Queue, File, Dst, Size, StartPos, UserData, false);
+    return Result;
+}
+
+external bool
+QueueFileWrite(io_queue* Queue, file File, void* Src, usz Size, usz StartPos, void* UserData)
+{
+    bool Result = _QueueFileRw(Queue, File, Src, Size, StartPos, UserData, true);
+    return Result;
+}
+
+external bool
+QueueFileSync(io_queue* Queue, file File, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    _io_op* Op = _GetIoOp(State, UserData);
+    if (!Op) return false;
+    
+    isz Result = FlushFileBuffers((HANDLE)File) ? 0 : -(isz)GetLastError();
+    return _PostIoOp(State, Op, Result);
+}
+
+external bool
+QueueFileOpen(io_queue* Queue, void* Filename, i32 Flags, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    _io_op* Op = _GetIoOp(State, UserData);
+    if (!Op) return false;
+    
+    file File = OpenFileHandle(Filename, Flags & ~HIDDEN_FILE);
+    isz Result = (File != INVALID_FILE) ? (isz)File : -(isz)GetLastError();
+    return _PostIoOp(State, Op, Result);
+}
+
+external bool
+QueueFileClose(io_queue* Queue, file File, void* UserData)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    _io_op* Op = _GetIoOp(State, UserData);
+    if (!Op) return false;
+    
+    isz Result = CloseHandle((HANDLE)File) ? 0 : -(isz)GetLastError();
+    return _PostIoOp(State, Op, Result);
+}
+
+external bool
+SubmitIoQueue(io_queue* Queue)
+{
+    // Overlapped IO is handed to the kernel by the call that starts it.
+    return true;
+}
+
+external u32
+WaitForCompletions(io_queue* Queue, io_completion* Completions, u32 MinCount, u32 MaxCount,
+                   usz TimeoutMs)
+{
+    _io_queue_state* State = (_io_queue_state*)Queue->State.Base;
+    MinCount = Min(MinCount, MaxCount);
+    u64 Deadline = (TimeoutMs == TIMEOUT_INFINITE) ? 0 : GetTickCount64() + TimeoutMs;
+    
+    u32 Result = 0;
+    while (Result < MaxCount)
+    {
+        DWORD Wait = 0;
+        if (Result < MinCount)
+        {
+            u64 Now = GetTickCount64();
+            if (TimeoutMs == TIMEOUT_INFINITE) Wait = INFINITE;
+            else if (Now < Deadline) Wait = (DWORD)Min(Deadline - Now, INFINITE-1);
+        }
+        
+        OVERLAPPED_ENTRY Entries[IO_QUEUE_REAP_BATCH];
+        ULONG Count = (ULONG)Min(MaxCount - Result, IO_QUEUE_REAP_BATCH);
+        ULONG Removed = 0;
+        if (!GetQueuedCompletionStatusEx(State->Port, Entries, Count, &Removed, Wait, FALSE))
+        {
+            break;
+        }
+        
+        for (ULONG Idx = 0; Idx < Removed; Idx++)
+        {
+            _io_op* Op = (_io_op*)Entries[Idx].lpOverlapped;
+            io_completion* Done = &Completions[Result++];
+            Done->UserData = Op->UserData;
+            usz Status = Op->Overlapped.Internal;
+            if (Op->Posted) Done->Result = Op->Result;
+            else if (Status == 0) Done->Result = (isz)Entries[Idx].dwNumberOfBytesTransferred;
+            else if (Status == IO_STATUS_END_OF_FILE) Done->Result = 0;
+            else Done->Result = -(isz)Status;
+            
+            Op->Next = State->FreeOps;
+            State->FreeOps = Op;
+        }
+        if (Removed < Count && Result >= MinCount) break;
+    }
+    return Result;
+}
+
+
+//========================================
+// File Mapping
+//========================================
+
+internal usz
+_GetMapAlignment(void)
+{
+    usz Result = (gSysInfo.MemBlockSize) ? gSysInfo.MemBlockSize : Kilobyte(64);
+    return Result;
+}
+
+external buffer
+MapFile(file File, usz Offset, usz Size, i32 Flags)
+{
+    buffer Result = {0};
+    if (!Size)
+    {
+        usz FileSize = FileSizeOf(File);
+        if (FileSize == USZ_MAX || FileSize <= Offset) return Result;
+        Size = FileSize - Offset;
+    }
+    
+    DWORD Protect = PAGE_READONLY, Access = FILE_MAP_READ;
+    if (Flags & MAPPED_WRITE)
+    {
+        Protect = PAGE_READWRITE;
+        Access = FILE_MAP_WRITE;
+    }
+    else if (Flags & MAPPED_COPY)
+    {
+        Protect = PAGE_WRITECOPY;
+        Access = FILE_MAP_COPY;
+    }
+    
+    // The view keeps the mapping object alive, so its handle can be closed right away.
+    HANDLE Mapping = CreateFileMappingW((HANDLE)File, NULL, Protect, 0, 0, NULL);
+    if (!Mapping) return Result;
+    
+    // Views have to start at the allocation granularity, so it begins a bit before [Offset].
+    usz Start = Offset - (Offset % _GetMapAlignment());
+    usz Lead = Offset - Start;
+    u8* Base = (u8*)MapViewOfFile(Mapping, Access, (DWORD)(Start >> 32),
+                                  (DWORD)(Start & 0xFFFFFFFF), Size + Lead);
+    CloseHandle(Mapping);
+    if (!Base) return Result;
+    
+    if (Flags & (MAPPED_POPULATE|MAPPED_WILLNEED))
+    {
+        WIN32_MEMORY_RANGE_ENTRY Range = { Base, Size + Lead };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    }
+    
+    Result = Buffer(Base + Lead, Size, Size);
+    return Result;
+}
+
+external buffer
+MapEntireFile(file File, i32 Flags)
+{
+    buffer Result = MapFile(File, 0, 0, Flags);
+    return Result;
+}
+
+external void
+UnmapFile(buffer* Map)
+{
+    if (Map->Base)
+    {
+        usz Lead = (usz)Map->Base % _GetMapAlignment();
+        UnmapViewOfFile(Map->Base - Lead);
+    }
+    memset(Map, 0, sizeof(buffer));
+}
+
+external bool
+FlushMappedRange(void* Start, usz Size)
+{
+    bool Result = FlushViewOfFile(Start, Size);
+    return Result;
+}
+
+
 //========================================
 // Filesystem
 //========================================
@@ -785,10 +1410,70 @@ UnloadExternalLibrary(file Library)
 external thread
 InitThread(thread_proc ThreadProc, void* ThreadArg, bool Waitable)
 {
-    // [Waitable] does nothing on Windows.
-    HANDLE Thread = CreateThread(NULL, Megabyte(2), (LPTHREAD_START_ROUTINE)ThreadProc,
-                                 ThreadArg, 0, 0);
-    thread Result = { (file)Thread };
+    thread_options Options = DEFAULT_THREAD_OPTIONS;
+    Options.Waitable = Waitable;
+    thread Result = InitThreadEx(ThreadProc, ThreadArg, &Options);
+    return Result;
+}
+
+external thread
+InitThreadEx(thread_proc ThreadProc, void* ThreadArg, thread_options* Options)
+{
+    // [.Waitable] does nothing on Windows. The thread starts suspended, so that its affinity
+    // and name are set before it runs.
+    thread Result = {0};
+    usz StackSize = (Options->StackSize) ? Options->StackSize : Megabyte(2);
+    DWORD ThreadID = 0;
+    HANDLE Thread = CreateThread(NULL, StackSize, (LPTHREAD_START_ROUTINE)ThreadProc, ThreadArg,
+                                 CREATE_SUSPENDED|STACK_SIZE_PARAM_IS_A_RESERVATION, &ThreadID);
+    if (!Thread) return Result;
+    
+    bool Success = true;
+    if (Options->Affinity)
+    {
+        Success = SetThreadAffinityMask(Thread, (DWORD_PTR)Options->Affinity) != 0;
+    }
+    else if (Options->Node != THREAD_ANY_NODE)
+    {
+        // Threads get memory from the node they run on, so running there is enough.
+        GROUP_AFFINITY Affinity;
+        Success = (GetNumaNodeProcessorMaskEx((USHORT)Options->Node, &Affinity)
+                   && SetThreadGroupAffinity(Thread, &Affinity, NULL));
+    }
+    if (Success && Options->Name)
+    {
+        wchar_t Name[64] = {0};
+        for (usz Idx = 0; Idx < ArrayCount(Name)-1 && Options->Name[Idx]; Idx++)
+        {
+            Name[Idx] = (wchar_t)Options->Name[Idx];
+        }
+        SetThreadDescription(Thread, Name);
+    }
+    
+    if (!Success)
+    {
+        TerminateThread(Thread, 0);
+        CloseHandle(Thread);
+        return Result;
+    }
+    
+    ResumeThread(Thread);
+    Result.Handle = (file)Thread;
+    Result.ID = ThreadID;
+    return Result;
+}
+
+external bool
+SetThreadAffinity(u64 Affinity)
+{
+    bool Result = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)Affinity) != 0;
+    return Result;
+}
+
+external u32
+GetThreadID(void)
+{
+    u32 Result = GetCurrentThreadId();
     return Result;
 }
 
@@ -849,33 +1534,34 @@ KillThread(thread* Thread)
 // Synchronization
 //========================================
 
-external mutex
-InitMutex(void)
+// Atomics for the locks in tinybase-platform-common.c. The Interlocked functions are full
+// barriers, which serves both taking and releasing a lock.
+
+internal u32
+_SyncLoad(u32* Src)
 {
-    mutex Result = {0};
-    *(HANDLE*)Result.Handle = CreateMutexA(NULL, FALSE, NULL);
-    return Result;
+    return *(volatile u32*)Src;
 }
 
-external bool
-CloseMutex(mutex* Mutex)
+internal u32
+_SyncExchange(u32* Dst, u32 Value)
 {
-    BOOL Result = CloseHandle(*(HANDLE*)Mutex->Handle);
-    return Result;
+    return (u32)InterlockedExchange((volatile LONG*)Dst, (LONG)Value);
 }
 
-external bool
-LockOnMutex(mutex* Mutex)
+internal bool
+_SyncCompareExchange(u32* Dst, u32* Expected, u32 Value)
 {
-    DWORD Result = WaitForSingleObject(*(HANDLE*)Mutex->Handle, INFINITE);
-    return (Result != WAIT_FAILED);
+    u32 Found = (u32)InterlockedCompareExchange((volatile LONG*)Dst, (LONG)Value, (LONG)*Expected);
+    bool Result = (Found == *Expected);
+    *Expected = Found;
+    return Result;
 }
 
-external bool
-UnlockMutex(mutex* Mutex)
+internal u32
+_SyncAddFetch(u32* Dst, u32 Value)
 {
-    BOOL Result = ReleaseMutex(*(HANDLE*)Mutex->Handle);
-    return Result;
+    return (u32)InterlockedExchangeAdd((volatile LONG*)Dst, (LONG)Value) + Value;
 }
 
 external semaphore
@@ -906,3 +1592,19 @@ WaitOnSemaphore(semaphore* Semaphore)
     DWORD Result = WaitForSingleObject(*(HANDLE*)Semaphore->Handle, INFINITE);
     return (Result != WAIT_FAILED);
 }
+
+internal bool
+_FutexWait(void* Address, i32 Expected, usz TimeoutMs)
+{
+    DWORD Timeout = (TimeoutMs >= INFINITE) ? INFINITE : (DWORD)TimeoutMs;
+    BOOL Result = WaitOnAddress(Address, &Expected, sizeof(i32), Timeout);
+    return (Result || GetLastError() != ERROR_TIMEOUT);
+}
+
+internal bool
+_FutexWake(void* Address, bool WakeAll)
+{
+    if (WakeAll) WakeByAddressAll(Address);
+    else WakeByAddressSingle(Address);
+    return true;
+}
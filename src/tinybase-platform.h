@@ -25,16 +25,14 @@
 # define INVALID_FILE USZ_MAX
 # define ASYNC_DATA_SIZE 40 // OVERLAPPED struct.
 # define DYNAMIC_LIB_EXT ".dll"
-# define MUTEX_SIZE 8 // Size of HANDLE
 # define SEMAPHORE_SIZE 8 // Size of HANDLE
 # define THREAD_PROC(Name) u32 Name(void* Arg)
 typedef u32 (*thread_proc)(void*);
 #elif defined(TT_LINUX)
 # define MAX_PATH_SIZE 4096
 # define INVALID_FILE USZ_MAX
-# define ASYNC_DATA_SIZE 184 // aiocb struct + timespec struct.
+# define ASYNC_DATA_SIZE 192 // Engine header + aiocb struct.
 # define DYNAMIC_LIB_EXT ".so"
-# define MUTEX_SIZE 40 // Size of pthread_mutex_t
 # define SEMAPHORE_SIZE 32 // Size of sem_t
 # define THREAD_PROC(Name) void* Name(void* Arg)
 typedef void* (*thread_proc)(void*);
@@ -46,21 +44,43 @@ typedef void* (*thread_proc)(void*);
 // Config
 //========================================
 
+#define MAX_CPU_INFO 256
+
+typedef struct cpu_info
+{
+    u16 Node;
+    u16 Package;
+    u16 Core;
+    u16 Sibling;
+} cpu_info;
+
 typedef struct sys_info
 {
     usz PageSize;
     usz MemBlockSize;
     usz NumThreads;
+    usz NumCores;
+    usz NumNodes;
+    usz HugePageSizes[2];
+    usz CacheSizes[3];
     isz AddressRange[2];
     f64 TimingFreq;
     char OSVersion[8];
+    cpu_info Cpus[MAX_CPU_INFO];
 } sys_info;
 global sys_info gSysInfo = {0};
 
 external void LoadSystemInfo(void);
 
 /* Reads system information and saves it to [gSysInfo] global variable. Must be called
- |  only once, before calling other functions in this library.
+ |  only once, before calling other functions in this library. [.HugePageSizes] gets the
+ |  huge page sizes the system supports, smallest first (e.g. 2MB and 1GB on x64), or zero
+ |  for the ones it does not. [.CacheSizes] gets the size of the L1 data, L2 and L3 caches
+ |  of the first CPU, or zero for the levels it does not have. [.Cpus] is indexed by CPU id
+ |  (up to MAX_CPU_INFO), and tells for each logical CPU its NUMA [.Node], its [.Package]
+ |  (socket), the [.Core] it belongs to (numbered from zero across the whole system), and
+ |  which hyperthread of the core it is ([.Sibling], zero for the first). Ids may have holes
+ |  when some CPUs are offline, and their entries are left zeroed.
  |--- Return: nothing. */
 
 //========================================
@@ -73,15 +93,81 @@ external void LoadSystemInfo(void);
 //                           others).
 #define MEM_EXEC     0x8  // Marks memory pages as executable.
 #define MEM_HUGEPAGE 0x10 // Reserves large memory pages, if the system supports.
+#define MEM_HUGEPAGE_1GB 0x20 // Same as MEM_HUGEPAGE, but tries 1GB pages first.
+#define MEM_PREFAULT 0x40 // Maps all pages in right away, instead of on first access.
+#define MEM_LOCK     0x80 // Locks the pages in physical memory, so they are never paged out.
+
+#define HUGEPAGE_NONE        0 // Got regular pages only.
+#define HUGEPAGE_EXPLICIT    1 // Got huge pages reserved from the system.
+#define HUGEPAGE_TRANSPARENT 2 // Got regular pages, that the system may merge into huge ones.
 
 external buffer GetMemory(usz Size, _opt void* Address, _opt int AccessFlags);
 
 /* Allocates memory block of [Size] bytes, rounded up to system page size. Block is
  |  guaranteed to be zeroed. A start [Address] can optionally be passed (system will
  |  choose random address if this is NULL). [AccessFlags] determines memory block
- |  behaviour; if none is passed, block is set to read-only.
+ |  behaviour; if none is passed, block is set to read-only. If MEM_LOCK is passed and the
+ |  pages can't be locked, the call fails.
+ |--- Return: buffer of allocated memory if successful, empty otherwise. */
+
+external buffer GetHugePageMemory(usz Size, _opt void* Address, _opt int AccessFlags,
+                                  _opt i32* Kind);
+
+/* Same as GetMemory(), but backs the block with huge pages, which cuts down on TLB misses
+ |  for large blocks that are accessed at random. It first tries to get pages reserved by the
+ |  system for this (on Linux, 1GB ones if MEM_HUGEPAGE_1GB is passed, and then 2MB ones);
+ |  failing that, it gets regular pages aligned to the huge page size, and asks the system
+ |  to back them with transparent huge pages (Linux only). [Size] is rounded up to the huge
+ |  page size. GetMemory() calls this when passed MEM_HUGEPAGE. If [Kind] is passed, it
+ |  receives one of the HUGEPAGE_ values, telling which one it got (HUGEPAGE_NONE when the
+ |  call fails).
  |--- Return: buffer of allocated memory if successful, empty otherwise. */
 
+external buffer GetMemoryOnNode(usz Size, i32 Node, _opt int AccessFlags);
+
+/* Same as GetMemory(), but the pages of the block are placed on NUMA node [Node] (as in
+ |  gSysInfo.Cpus[].Node), so that threads running on that node access it without crossing
+ |  to another socket. On Linux the block is bound to the node, and on Windows the node is
+ |  only preferred.
+ |--- Return: buffer of allocated memory if successful, empty otherwise. */
+
+external bool SetThreadMemoryNode(i32 Node);
+
+/* Makes memory allocated by the calling thread from now on be placed on NUMA node [Node],
+ |  if possible. Pass -1 to go back to the system default. The node is only preferred, and
+ |  the CPUs the thread runs on are not changed. On Windows, where there is no such policy,
+ |  the thread's ideal processor is set to a CPU of [Node], which the system allocates from,
+ |  and -1 does nothing.
+ |--- Return: true if successful, false if not. */
+
+external buffer ReserveMemory(usz Size, _opt void* Address);
+
+/* Reserves a range of [Size] bytes of address space, rounded up to system page size, without
+ |  committing any memory to it. Nothing in the range can be accessed until it is committed
+ |  with CommitMemory(). An [Address] to reserve at can optionally be passed.
+ |--- Return: buffer of reserved range if successful, empty otherwise. */
+
+external bool CommitMemory(void* Address, usz Size, int AccessFlags);
+
+/* Commits [Size] bytes starting at [Address], inside a range got from ReserveMemory(), and
+ |  sets their access to [AccessFlags]. Committed pages read as zero until written to. Pass
+ |  MEM_PREFAULT to have the pages mapped in right away, and MEM_LOCK to keep them from ever
+ |  being paged out (which may need elevated privileges or a raised limit).
+ |--- Return: true if successful, false if not. */
+
+external bool DecommitMemory(void* Address, usz Size);
+
+/* Gives the [Size] bytes of memory starting at [Address] back to the system, keeping the
+ |  range reserved. The contents are lost, and the pages can't be accessed until committed
+ |  again.
+ |--- Return: true if successful, false if not. */
+
+external bool ProtectMemory(void* Address, usz Size, int AccessFlags);
+
+/* Changes the access of the committed pages in the [Size] bytes starting at [Address] to
+ |  [AccessFlags] (e.g. MEM_GUARD to turn them into guard pages).
+ |--- Return: true if successful, false if not. */
+
 external void ClearMemory(buffer* Mem);
 
 /* Clears entire buffer in [Mem] to zero.
@@ -89,7 +175,8 @@ external void ClearMemory(buffer* Mem);
 
 external void FreeMemory(buffer* Mem);
 
-/* Frees memory block allocated with GetMemory(). Frees the entire block at once.
+/* Frees memory block allocated with GetMemory(), or range reserved with ReserveMemory().
+ |  Frees the entire block at once.
  |--- Return: nothing. */
 
 external buffer GetMemoryFromHeap(usz Size);
@@ -103,6 +190,139 @@ external void FreeMemoryFromHeap(buffer* Mem);
  |--- Return: nothing. */
 
 
+typedef struct vm_arena
+{
+    union
+    {
+        buffer Buffer;
+        struct
+        {
+            u8* Base;
+            usz WriteCur;
+            usz Size;
+        };
+    };
+    usz ReservedSize;
+    usz CommitChunk;
+} vm_arena;
+
+/* Arena backed by a range of reserved address space, of which only the first [.Size] bytes
+ |  are committed (i.e. usable, and counted towards the process memory). The rest of the
+ |  [.ReservedSize] bytes is committed [.CommitChunk] bytes at a time, as pushes go past the
+ |  committed region. Since the range never moves, pointers into the arena stay valid as it
+ |  grows. [.Buffer] can be passed to functions that take a buffer. */
+
+external bool ReserveVMArena(vm_arena* Arena, usz ReserveSize, _opt usz CommitChunk);
+
+/* Reserves [ReserveSize] bytes of address space for [Arena], without committing any of it.
+ |  The range can be much larger than physical memory (e.g. 64GB). [CommitChunk] is how much
+ |  is committed at a time; if zero, defaults to 64KB. Both are rounded up to page size.
+ |--- Return: true if successful, false if not. */
+
+external void* PushIntoVMArena(vm_arena* Arena, usz Size);
+
+/* Creates new region in [Arena] of [Size] bytes, advancing its [.WriteCur] accordingly, and
+ |  committing more memory if needed.
+ |--- Return: pointer to the beginning of region if successful, NULL if the reserved range
+ |            is exhausted or the system fails to commit the memory. */
+
+external void* PushIntoVMArenaAligned(vm_arena* Arena, usz Size, usz Alignment);
+
+/* Same as PushIntoVMArena(), but the region starts at an address that is a multiple of
+ |  [Alignment], which must be a power of two.
+ |--- Return: pointer to the beginning of region if successful, NULL if not. */
+
+external void ResetVMArena(vm_arena* Arena, bool Decommit);
+
+/* Sets [.WriteCur] of [Arena] back to zero. If [Decommit] is true, also returns all of its
+ |  committed memory to the system, keeping only the reserved range, and the next pushes
+ |  will get zeroed memory again.
+ |--- Return: nothing. */
+
+external void FreeVMArena(vm_arena* Arena);
+
+/* Releases the whole range reserved for [Arena], and clears the struct.
+ |--- Return: nothing. */
+
+#define SCRATCH_ARENA_COUNT 2
+#define SCRATCH_ARENA_RESERVE Gigabyte(8)
+
+external vm_arena* GetScratchArena(_opt buffer** Conflicts, usz NumConflicts);
+
+/* Gets one of the calling thread's scratch arenas, for temporary memory that is thrown away
+ |  with ArenaBeginTemp()/ArenaEndTemp() on its [.Buffer]. Each thread has SCRATCH_ARENA_COUNT
+ |  of them, reserved on first use. [Conflicts] is a list of [NumConflicts] arenas that must
+ |  not be returned, such as a scratch arena the caller got from its own caller to push its
+ |  results into; this way nested functions never roll back each other's memory. Arenas in
+ |  [Conflicts] that are not scratch arenas are ignored.
+ |--- Return: scratch arena if successful, NULL if all of them conflict or the system failed
+ |            to reserve one. */
+
+external void FreeScratchArenas(void);
+
+/* Releases the scratch arenas of the calling thread. Call before the thread exits, if it
+ |  used any of them.
+ |--- Return: nothing. */
+
+#define SLAB_SIZE Kilobyte(64)
+#define SLAB_HEADER_SIZE 16
+#define SLAB_MIN_SHIFT 4
+#define SLAB_MIN_OBJECT (1 << SLAB_MIN_SHIFT)
+#define SLAB_NUM_CLASSES 8
+#define SLAB_MAX_OBJECT (SLAB_MIN_OBJECT << (SLAB_NUM_CLASSES-1))
+
+typedef struct slab_allocator
+{
+    pool Classes[SLAB_NUM_CLASSES];
+    void* Slabs;
+} slab_allocator;
+
+/* General-purpose allocator for small objects, with one pool per size class. Classes are
+ |  powers of two from SLAB_MIN_OBJECT to SLAB_MAX_OBJECT bytes, and each pool carves its
+ |  objects out of SLAB_SIZE slabs got from GetMemory(), which are linked through [.Slabs].
+ |  Not thread-safe; use one allocator per thread, or guard it with a lock. */
+
+external void InitSlabAllocator(slab_allocator* Slab);
+
+/* Sets up [Slab] with empty pools. No memory is allocated until the first SlabAlloc().
+ |--- Return: nothing. */
+
+external void* SlabAlloc(slab_allocator* Slab, usz Size);
+
+/* Gets a region of at least [Size] bytes from the pool of its size class, aligned to 16
+ |  bytes. Sizes bigger than SLAB_MAX_OBJECT go straight to GetMemory().
+ |--- Return: pointer to the region if successful, NULL if not. */
+
+external void SlabFree(slab_allocator* Slab, void* Ptr, usz Size);
+
+/* Gives the region at [Ptr] back to [Slab]. [Size] must be the same as passed to the
+ |  SlabAlloc() that returned it. Slabs themselves are never returned to the system until
+ |  FreeSlabAllocator() is called.
+ |--- Return: nothing. */
+
+external void FreeSlabAllocator(slab_allocator* Slab);
+
+/* Frees all slabs of [Slab], invalidating every region in them, and leaves it ready to be
+ |  used again. Regions bigger than SLAB_MAX_OBJECT are not tracked, and must be freed
+ |  with SlabFree() before this.
+ |--- Return: nothing. */
+
+#define TLSF_GROW_SIZE Megabyte(1)
+
+external TLSF_GROW_PROC(GrowTLSFFromMemory);
+
+/* Grow callback for InitTLSF(), that adds a region got from GetMemory() to [Allocator], of
+ |  TLSF_GROW_SIZE bytes or whatever [MinSize] needs, if bigger. The regions are linked
+ |  through the allocator's [.GrowArg], so NULL must be passed as [GrowArg] to InitTLSF().
+ |--- Return: true if successful, false if not. */
+
+external void FreeTLSF(tlsf* Allocator);
+
+/* Frees all regions that GrowTLSFFromMemory() added to [Allocator], invalidating every
+ |  region allocated from it, and leaves it empty, ready to be used again.
+ |--- Return: nothing. */
+
+
 //========================================
 // FileIO
 //========================================
@@ -118,6 +338,9 @@ external void FreeMemoryFromHeap(buffer* Mem);
 #define FORCE_CREATE 0x100 // Overwrite existing file during creation.
 #define FORCE_OPEN   0x200 // Create new file if one does not exist already.
 
+#define IO_NOWAIT 0x1 // Stop instead of blocking on data not in the page cache (Linux only).
+#define IO_DSYNC  0x2 // Make the written data durable before returning.
+
 typedef usz file;
 
 typedef struct async
@@ -136,6 +359,8 @@ external file OpenFileHandle(void* Filename, i32 Flags);
 
 /* Opens file at path [Filename]. Path must be at the Unicode encoding native to the
  |  system (e.g. UTF16 on Windows, UTF8 on Linux). Open flags must be passed to [Flags].
+ |  FORCE_OPEN creates the file if it does not exist, and FORCE_CREATE truncates it if it
+ |  does.
 |--- Return: file handle if successful, or INVALID_FILE if not.*/
 
 external void CloseFileHandle(file File);
@@ -146,15 +371,18 @@ external void CloseFileHandle(file File);
 external buffer ReadEntireFile(file File);
 
 /* Takes in an open [File] handle, allocated memory for it with read/write access, and
- |  copies entire file content to it.
+ |  copies entire file content to it. For big files that are only scanned, MapEntireFile()
+ |  saves the copy.
 |--- Return: buffer with memory if successful, or empty buffer if not. */
 
 external bool ReadFromFile(file File, buffer* Dst, usz AmountToRead, usz StartPos);
 
 /* Copies [AmountToRead] bytes from [File] at [StartPos] offset into [Dst] memory.
- |  Memory must already be allocated. If [StartPos] + [AmountToRead] goes beyond EOF,
- | nothing is copied and function fails.
- |--- Return: true if read operation was successfully started, false if not. */
+ |  Memory must already be allocated. The read is positional, so it is safe for threads to
+ |  share [File] (on Linux it also leaves the file pointer alone; on Windows it doesn't, so
+ |  don't mix it with calls that rely on it). If [StartPos] + [AmountToRead] goes beyond EOF,
+ |  the function fails and [Dst] is not advanced (though its free space may be written).
+ |--- Return: true if successful, false if not. */
 
 external bool ReadFileAsync(file File, buffer* Dst, usz AmountToRead, usz StartPos,
                             async* Async);
@@ -163,28 +391,53 @@ external bool ReadFileAsync(file File, buffer* Dst, usz AmountToRead, usz StartP
  |  [Dst], with at least [AmountToRead] size. [Async] is a pointer to an unitialized
  |  object that will receive platform-specific async IO data, to be later passed to the
  |  completion function. File is read in chunks of U32_MAX, so if [AmountToRead] is
- |  larger than that multiple reads will be posted.
+ |  larger than that multiple reads will be posted. On Linux the read goes through the
+ |  calling thread's io_uring, or through POSIX aio on kernels without it (pre-5.6); with
+ |  io_uring, only the calling thread can wait on it with WaitOnIoCompletion().
 |--- Return: true if read operation was successfully started, false if not. */
 
 external bool AppendToFile(file File, buffer Content);
 
 /* Writes data in [Content] at EOF of [File]. This function is for files that were NOT
  |  opened with APPEND_FILE flag; for those that were, any regular write call will always
- |  append.
+ |  append. EOF is found by the system as part of the write, so threads and processes can
+ |  append to the same file at once without overwriting each other.
  |--- Return: true if successful, false if not. */
 
 external bool WriteEntireFile(file File, buffer Content);
 
-/* Writes data in [Content] at beginning of [File]. If file was opened with APPEND_FILE
- |  flag, writes at EOF.
+/* Writes data in [Content] at beginning of [File]. Like WriteToFile(), the write is
+ |  positional. If file was opened with APPEND_FILE flag, writes at EOF.
 |--- Return: true if successful, false is not. */
 
 external bool WriteToFile(file File, buffer Content, usz StartPos);
 
-/* Writes data in [Content] at [StartPos] of [File]. If file was opened with APPEND_FILE
- |  flag, [StartPos] is ignored and it writes at EOF.
+/* Writes data in [Content] at [StartPos] of [File]. The write is positional, so it is safe
+ |  for threads to share [File] (the file pointer is left alone on Linux, but moved on
+ |  Windows). If file was opened with APPEND_FILE flag, [StartPos] is ignored and it
+ |  writes at EOF.
  |--- Return: true if successful, false if not. */
 
+external usz WriteBuffersToFile(file File, buffer* Buffers, u32 Count, usz StartPos,
+                               i32 Flags);
+
+/* Writes the data of [Count] [Buffers] (each up to its [.WriteCur]) back to back into
+ |  [File], starting at [StartPos], as if they were one contiguous buffer. On Linux this is
+ |  a single vectored write per batch of buffers, so there is no need to copy them together
+ |  first. [Flags] can be IO_DSYNC, and IO_NOWAIT on Linux (which not every filesystem
+ |  supports for buffered writes, making the call fail).
+ |--- Return: number of bytes written, which is less than the total only with IO_NOWAIT, or
+ |            USZ_MAX if there was an error. */
+
+external usz ReadIntoBuffers(file File, buffer* Buffers, u32 Count, usz StartPos,
+                             i32 Flags);
+
+/* Reads from [File] at [StartPos] into the free space of [Count] [Buffers], filling one
+ |  before moving on to the next, and advancing their [.WriteCur]. Stops early at EOF, or
+ |  with IO_NOWAIT on Linux when the rest of the data is not cached. [Flags] can be
+ |  IO_NOWAIT.
+ |--- Return: number of bytes read, or USZ_MAX if there was an error. */
+
 external bool WriteFileAsync(file File, void* Src, usz AmountToWrite, usz StartPos,
                              async* Async);
 
@@ -192,17 +445,61 @@ external bool WriteFileAsync(file File, void* Src, usz AmountToWrite, usz StartP
  |  manner. If file was opened with APPEND_FILE flag, writes at EOF. [Async] is a pointer
  |  to an unitialized object that will receive platform-specific async IO data, to be
  |  later passed to the completion function. File is written to in chunks of U32_MAX, so
- |  if [AmountToRead] is larger than that multiple reads will be posted.
+ |  if [AmountToRead] is larger than that multiple reads will be posted. Same as in
+ |  ReadFileAsync(), on Linux only the calling thread can wait on it.
  |--- Return: true if write operation was successfully started, false if not. */
 
 external usz WaitOnIoCompletion(file File, async* Async, bool Block);
 
 /* Waits until an async IO operation done on [File] completes. [Async] is a pointer to
  |  the same object used when start the IO. [Block] determines if the call waits
- |  indefinitely or returns immediately if it'd block.
+ |  indefinitely or returns immediately if it'd block. On Linux with io_uring each thread
+ |  has its own ring, so this must be called from the thread that started the IO, and
+ |  fails if called from any other; a non-blocking call only reads the completion ring,
+ |  without a system call.
 |--- Return: number of bytes transferred; 0 means an error if [Block], and a timeout
  |            if not. */
 
+external void BeginIoBatch(void);
+
+/* Makes the ReadFileAsync() and WriteFileAsync() calls that follow only queue their
+ |  operations, which are then handed to the kernel all at once by EndIoBatch(), with a
+ |  single system call. Applies to the calling thread only. Has no effect on Windows, or
+ |  on Linux without io_uring.
+ |--- Return: nothing. */
+
+external bool EndIoBatch(void);
+
+/* Submits all operations queued since BeginIoBatch(), and goes back to submitting each
+ |  async operation as it is made.
+ |--- Return: true if successful, false if the kernel refused the operations. */
+
+external bool RegisterIoBuffers(buffer* Buffers, u32 Count);
+
+/* Registers up to 16 [Buffers] with the calling thread's io_uring, so that their pages
+ |  are pinned once instead of on every operation. Async IO whose memory falls entirely
+ |  inside one of them then uses it automatically. Replaces any previous registration, and
+ |  a [Count] of 0 only drops it. The memory must remain valid while registered. Has no
+ |  effect on Windows.
+ |--- Return: true if successful, false if not (e.g. io_uring is not available, or the
+ |            memory lock limit was hit). */
+
+external bool RegisterIoFiles(file* Files, u32 Count);
+
+/* Registers up to 64 [Files] with the calling thread's io_uring, which saves the kernel
+ |  from looking up the file on every operation. Async IO on these files then uses the
+ |  registration automatically. Replaces any previous registration, and a [Count] of 0
+ |  only drops it. Files must remain open while registered. Has no effect on Windows.
+ |--- Return: true if successful, false if not. */
+
+external void CloseAsyncIo(void);
+
+/* Releases the io_uring of the calling thread, along with its registered buffers and
+ |  files. All its async operations must have completed. A new one is set up if the
+ |  thread does async IO again. Threads release their ring on exit anyway, so this is
+ |  only needed to free it earlier.
+ |--- Return: nothing. */
+
 external usz FileLastWriteTime(file File);
 
 /* Gets last time [File] was written to, in system units.
@@ -245,6 +542,138 @@ external bool SeekFile(file File, usz Pos);
 |--- Return: true if successful, false if not. */
 
 
+//========================================
+// IO Queues
+//========================================
+
+typedef struct io_queue
+{
+    buffer State;
+} io_queue;
+
+/* Queue of file operations that run in the background, and whose completions are then
+ |  reaped in batches. [.State] holds the platform data, which is an io_uring on Linux and
+ |  an IO completion port on Windows. Linux kernels without io_uring (pre-5.6) have each
+ |  operation run when queued, with only its completion being deferred. An io_queue is not
+ |  thread-safe, and is meant to be driven by a single thread. */
+
+typedef struct io_completion
+{
+    void* UserData;
+    isz Result;
+} io_completion;
+
+/* Completion of a queued operation, tagged with the [UserData] it was queued with. For
+ |  reads and writes [.Result] is the number of bytes transferred, for opens it is the new
+ |  file handle, and for syncs and closes it is 0. It is negative if the operation failed. */
+
+external bool InitIoQueue(io_queue* Queue, u32 Entries);
+
+/* Sets up [Queue] with room for [Entries] operations in flight at once (rounded up to a
+ |  power of two on Linux).
+ |--- Return: true if successful, false if not. */
+
+external void CloseIoQueue(io_queue* Queue);
+
+/* Frees all resources of [Queue]. All its operations must have been reaped first.
+ |--- Return: nothing. */
+
+external bool QueueFileRead(io_queue* Queue, file File, void* Dst, usz Size, usz StartPos,
+                            void* UserData);
+
+/* Queues a read of [Size] bytes from [File] at [StartPos] into [Dst], which must remain
+ |  valid until the operation completes. [Size] must not exceed U32_MAX, and may come back
+ |  short at EOF. On Windows, [File] must have been opened with ASYNC_FILE, and gets bound
+ |  to the queue, so ReadFileAsync() and WriteFileAsync() can no longer be used with it.
+ |--- Return: true if queued, false if the queue is full or the request is invalid. If
+ |            the queue is full, reaping completions with WaitForCompletions() makes room. */
+
+external bool QueueFileWrite(io_queue* Queue, file File, void* Src, usz Size, usz StartPos,
+                             void* UserData);
+
+/* Queues a write of [Size] bytes from [Src] to [File] at [StartPos]. Same rules as in
+ |  QueueFileRead() apply.
+ |--- Return: true if queued, false if the queue is full or the request is invalid. */
+
+external bool QueueFileSync(io_queue* Queue, file File, void* UserData);
+
+/* Queues a flush of all data written to [File] into the storage device.
+ |--- Return: true if queued, false if the queue is full. */
+
+external bool QueueFileOpen(io_queue* Queue, void* Filename, i32 Flags, void* UserData);
+
+/* Queues an open of file at path [Filename], with the same [Flags] as OpenFileHandle()
+ |  (HIDDEN_FILE excepted). [Filename] must remain valid until the queue is submitted. The
+ |  handle comes back in the [.Result] of the completion.
+ |--- Return: true if queued, false if the queue is full. */
+
+external bool QueueFileClose(io_queue* Queue, file File, void* UserData);
+
+/* Queues the closing of [File]. It must not be used by any other operation in flight.
+ |--- Return: true if queued, false if the queue is full. */
+
+external bool SubmitIoQueue(io_queue* Queue);
+
+/* Hands all operations queued so far to the kernel, with a single system call. This is
+ |  also done by WaitForCompletions(), and whenever the queue fills up.
+ |--- Return: true if successful, false if not (e.g. too many completions are waiting to
+ |            be reaped). Operations not handed over stay queued, and WaitForCompletions()
+ |            hands them over once it has made room. */
+
+external u32 WaitForCompletions(io_queue* Queue, io_completion* Completions, u32 MinCount,
+                                u32 MaxCount, usz TimeoutMs);
+
+/* Submits the operations queued on [Queue], then waits until at least [MinCount] of them
+ |  completed or [TimeoutMs] milliseconds have passed (TIMEOUT_INFINITE waits forever).
+ |  Up to [MaxCount] completions are written to [Completions], in the order they finished.
+ |  A [MinCount] of 0 only takes the ones that are already done.
+ |--- Return: number of completions written. */
+
+
+//========================================
+// File Mapping
+//========================================
+
+#define MAPPED_READ       0x1  // Map pages read-only.
+#define MAPPED_WRITE      0x2  // Map pages read-write, with writes going to the file.
+#define MAPPED_COPY       0x4  // Map pages read-write, with writes kept private (copy-on-write).
+#define MAPPED_POPULATE   0x8  // Read in the whole range while mapping it.
+#define MAPPED_SEQUENTIAL 0x10 // Hint that the range will be read in order (Linux only).
+#define MAPPED_RANDOM     0x20 // Hint that the range will be read out of order (Linux only).
+#define MAPPED_WILLNEED   0x40 // Start reading in the range in the background.
+
+external buffer MapFile(file File, usz Offset, usz Size, i32 Flags);
+
+/* Maps [Size] bytes of [File] starting at [Offset] into memory, so the page cache serves
+ |  reads directly instead of them being copied. A [Size] of 0 maps up to EOF. [Flags] takes
+ |  one of MAPPED_READ, MAPPED_WRITE or MAPPED_COPY, plus any of the other MAPPED_ flags. The
+ |  file must have been opened with access matching the mode (read for MAPPED_READ and
+ |  MAPPED_COPY, read and write for MAPPED_WRITE). [Offset] need not be aligned.
+ |--- Return: buffer with the mapped range (with [.WriteCur] at its end) if successful, or
+ |            empty buffer if not. */
+
+external buffer MapEntireFile(file File, i32 Flags);
+
+/* Same as ReadEntireFile(), but maps [File] instead of copying it into new memory, which
+ |  avoids holding the file twice in memory. [Flags] is as in MapFile(), and MAPPED_COPY
+ |  gives a buffer that can be written to like the one from ReadEntireFile(). The buffer
+ |  must be released with UnmapFile().
+ |--- Return: buffer with the mapped file if successful, or empty buffer if not. */
+
+external void UnmapFile(buffer* Map);
+
+/* Unmaps a range got from MapFile() or MapEntireFile(), and clears [Map]. Writes done to a
+ |  MAPPED_WRITE range still reach the file, though not necessarily right away.
+ |--- Return: nothing. */
+
+external bool FlushMappedRange(void* Start, usz Size);
+
+/* Writes the modified pages in [Size] bytes from [Start], inside a MAPPED_WRITE range, back
+ |  to the file, and waits until done. On Windows, the file also needs FlushFileBuffers()
+ |  for the data to be durable.
+ |--- Return: true if successful, false if not. */
+
+
 //========================================
 // Filesystem
 //========================================
@@ -461,12 +890,35 @@ external bool UnloadExternalLibrary(file Library);
 #define SCHEDULE_LOW     2
 #define SCHEDULE_HIGH    4
 
+#define THREAD_ANY_NODE -1
+#define DEFAULT_THREAD_OPTIONS { 0, 0, NULL, THREAD_ANY_NODE, true }
+
 typedef struct thread
 {
     file Handle;
-    // Space reserved for expansion.
+    u32 ID;
 } thread;
 
+/* [.Handle] is the system's handle to the thread, and [.ID] the id the system knows the
+ |  thread by (the one shown by tools like top or the Task Manager). */
+
+typedef struct thread_options
+{
+    usz StackSize;
+    u64 Affinity;
+    const char* Name;
+    i32 Node;
+    bool Waitable;
+} thread_options;
+
+/* Options for InitThreadEx(); start from DEFAULT_THREAD_OPTIONS and change the ones needed.
+ |  [.StackSize] is the size of the thread's stack, or zero for 2MB. [.Affinity] is a mask of
+ |  the CPUs the thread is allowed to run on (bit N for CPU N, up to 64), or zero for any.
+ |  [.Name] is shown by debuggers and profilers (up to 15 chars on Linux), and can be NULL.
+ |  [.Node] is the NUMA node the thread allocates memory from and, if no [.Affinity] is
+ |  given, runs on; THREAD_ANY_NODE leaves it to the system. [.Waitable] is the same as in
+ |  InitThread(). */
+
 external thread InitThread(thread_proc ThreadProc, void* ThreadArg, bool Waitable);
 
 /* Creates a new thread. [ThreadProc] specifies the entry point, and should be a
@@ -476,6 +928,24 @@ external thread InitThread(thread_proc ThreadProc, void* ThreadArg, bool Waitabl
  |  otherwise it must call CloseThread() after it knows the thread has finished.
 |--- Return: thread object, or empty object if creation failed. */
 
+external thread InitThreadEx(thread_proc ThreadProc, void* ThreadArg, thread_options* Options);
+
+/* Same as InitThread(), but with the settings in [Options]. The affinity, node and name are
+ |  set before [ThreadProc] is called, so it never runs on other CPUs; if the affinity can't
+ |  be set (e.g. no CPU in the mask exists), [ThreadProc] is not called at all.
+|--- Return: thread object, or empty object if creation or setting the affinity failed. */
+
+external bool SetThreadAffinity(u64 Affinity);
+
+/* Restricts the calling thread to run only on the CPUs set in [Affinity] (bit N for CPU N).
+ |  Pass the CPUs of a single core to pin the thread to it.
+|--- Return: true if successful, false if not. */
+
+external u32 GetThreadID(void);
+
+/* Gets the id of the calling thread, as in [.ID] of the thread object.
+|--- Return: thread id. */
+
 external bool ChangeThreadScheduling(thread* Thread, int NewScheduling);
 
 /* Change how frequently [Thread] is awoken by the system. [NewScheduling] can either
@@ -513,33 +983,124 @@ external bool KillThread(thread* Thread);
 // Synchronization
 //========================================
 
+#define TIMEOUT_INFINITE USZ_MAX
+
 typedef struct mutex
 {
-    u8 Handle[MUTEX_SIZE];
+    u32 State;
 } mutex;
 
+/* Lock that makes threads sleep on a futex while it's taken. [.State] is 0 when unlocked,
+|  1 when locked, and 2 when locked with other threads possibly waiting on it. Locking and
+|  unlocking an uncontended mutex costs a single atomic operation each, without syscalls.
+|  The struct needs no cleanup and can be zero-initialized, so it can be embedded in arrays
+|  or other structs (e.g. one per hash-bucket). */
+
 external mutex InitMutex(void);
 
-/* Inits a mutex in an unlocked state.
-|--- Return: mutex object, or empty object in failure. */
+/* Inits a mutex in an unlocked state. Same as zero-initializing it.
+|--- Return: mutex object. */
 
 external bool CloseMutex(mutex* Mutex);
 
-/* Closes the [Mutex] object.
+/* Closes the [Mutex] object. There are no resources to release, so this exists only for
+|  symmetry with InitMutex(). [Mutex] must not be locked.
 |--- Return: true if successful, false if not. */
 
 external bool LockOnMutex(mutex* Mutex);
 
-/* Acquires the lock on the mutex. If the mutex is already locked by another thread,
-|  it will block until the mutex is released.
+/* Acquires the lock on the mutex. If the mutex is already locked by another thread, it
+|  spins for a short while, and then sleeps until the mutex is released.
 |--- Return: true if successful, false if not. */
 
+external bool TryLockMutex(mutex* Mutex);
+
+/* Tries to acquire the lock on the mutex, without blocking.
+|--- Return: true if lock was acquired, false if mutex is already locked. */
+
 external bool UnlockMutex(mutex* Mutex);
 
-/* Releases the lock on the mutex.
+/* Releases the lock on the mutex. Only makes a syscall if some thread may be sleeping on it.
 |--- Return: true if successful, false if not. */
 
 
+#define RWLOCK_WRITER  0x80000000
+#define RWLOCK_WAITERS 0x40000000
+#define RWLOCK_READERS 0x3FFFFFFF
+
+typedef struct rwlock
+{
+    u32 State;
+} rwlock;
+
+/* Reader-writer lock that favours readers: new readers get in for as long as no writer is
+|  holding the lock, even when writers are waiting. Meant for read-mostly data. [.State]
+|  holds the number of readers in the RWLOCK_READERS bits, and the RWLOCK_WRITER and
+|  RWLOCK_WAITERS flags for when a writer holds the lock and when threads may be sleeping
+|  on it. Can be zero-initialized, and needs no cleanup. */
+
+external rwlock InitRWLock(void);
+
+/* Inits a rwlock in an unlocked state. Same as zero-initializing it.
+|--- Return: rwlock object. */
+
+external void LockForReading(rwlock* Lock);
+
+/* Acquires [Lock] for shared access. Blocks while a writer holds it. Uncontended, this
+|  costs a single atomic operation.
+|--- Return: nothing. */
+
+external void UnlockForReading(rwlock* Lock);
+
+/* Releases shared access acquired with LockForReading(). The last reader to leave wakes up
+|  any threads waiting on [Lock].
+|--- Return: nothing. */
+
+external void LockForWriting(rwlock* Lock);
+
+/* Acquires [Lock] for exclusive access. Blocks while any reader or writer holds it.
+|--- Return: nothing. */
+
+external void UnlockForWriting(rwlock* Lock);
+
+/* Releases exclusive access acquired with LockForWriting(), and wakes up any threads
+|  waiting on [Lock].
+|--- Return: nothing. */
+
+
+typedef struct condvar
+{
+    u32 Seq;
+} condvar;
+
+/* Condition variable. [.Seq] is bumped on every signal, and waiters sleep on it with the
+|  value they read before unlocking the mutex, so a signal sent in between is never lost.
+|  Can be zero-initialized, and needs no cleanup. */
+
+external condvar InitCondVar(void);
+
+/* Inits a condition variable. Same as zero-initializing it.
+|--- Return: condvar object. */
+
+external bool WaitOnCondVar(condvar* Cond, mutex* Mutex, usz TimeoutMs);
+
+/* Releases [Mutex], which must be locked by the calling thread, and sleeps until [Cond] is
+|  signaled or [TimeoutMs] milliseconds have passed (TIMEOUT_INFINITE waits forever). The
+|  mutex is locked again before returning. Wake-ups can be spurious, so always check the
+|  condition again in a loop.
+|--- Return: true if woken up, false if timed out. */
+
+external void SignalCondVar(condvar* Cond);
+
+/* Wakes up one thread waiting on [Cond].
+|--- Return: nothing. */
+
+external void BroadcastCondVar(condvar* Cond);
+
+/* Wakes up all threads waiting on [Cond].
+|--- Return: nothing. */
+
+
 typedef struct semaphore
 {
     u8 Handle[SEMAPHORE_SIZE];
@@ -568,12 +1129,30 @@ external bool IncreaseSemaphore(semaphore* Semaphore);
 |--- Return: true if successful, false if not. */
 
 
+external bool WaitOnFutex(void* Address, i32 Expected, usz TimeoutMs);
+
+/* Puts the calling thread to sleep for as long as the 4-byte value at [Address] equals
+|  [Expected], until another thread calls WakeFutex() on the same address, or until
+|  [TimeoutMs] milliseconds have passed (pass TIMEOUT_INFINITE to wait with no timeout).
+|  The comparison and going to sleep are done atomically, so a wake issued after the
+|  value has changed is never missed. The thread may also wake up spuriously, so the
+|  caller must check the value again when this returns.
+|--- Return: true if woken up or if the value was already different, false if timed out. */
+
+external bool WakeFutex(void* Address, bool WakeAll);
+
+/* Wakes up one thread sleeping on WaitOnFutex() for [Address], or all of them if [WakeAll]
+|  is true. Change the value at [Address] before calling this.
+|--- Return: true if successful, false if not. */
+
+
 #if !defined(TT_STATIC_LINKING)
 # if defined(TT_WINDOWS)
 #  include "tinybase-platform-win32.c"
 # elif defined(TT_LINUX)
 #  include "tinybase-platform-linux.c"
 # endif //TT_WINDOWS
+# include "tinybase-platform-common.c"
 #endif //TT_STATIC_LINKING
 
 #endif //TINYBASE_PLATFORM_H
@@ -1,3 +1,16 @@
+#define QUEUE_SPIN_COUNT 64
+
+internal usz
+_QueueTimeLeft(timing* Timer, usz TimeoutMs)
+{
+    if (TimeoutMs == TIMEOUT_INFINITE) return TIMEOUT_INFINITE;
+    
+    StopTiming(Timer);
+    usz Elapsed = (usz)(Timer->Diff * 1000.0);
+    return (Elapsed < TimeoutMs) ? TimeoutMs - Elapsed : 0;
+}
+
+
 //================
 // MPSC Free List
 //================
@@ -7,6 +20,21 @@ InitMPSCFreeList(mpsc_freelist* Queue)
 {
     Queue->Head = &Queue->Stub;
     Queue->Tail = &Queue->Stub;
+    Queue->Stub.Next = NULL;
+    Queue->Waiters = 0;
+    Queue->Signal = 0;
+}
+
+internal void
+_MPSCFreeListWake(mpsc_freelist* Queue)
+{
+    // Read after the exchange on [.Head], so either the consumer sees the new node before
+    // sleeping, or this sees the consumer's waiter count.
+    if (AtomicLoad32Explicit(&Queue->Waiters, ATOMIC_SEQ_CST) > 0)
+    {
+        AtomicAddFetch32(&Queue->Signal, 1);
+        WakeFutex(&Queue->Signal, false);
+    }
 }
 
 external void
@@ -14,8 +42,21 @@ MPSCFreeListPush(mpsc_freelist* Queue, void* Item)
 {
     mpsc_node* Node = (mpsc_node*)Item;
     Node->Next = NULL;
-    mpsc_node* Prev = (mpsc_node*)AtomicExchangePtr((void* volatile*)&Queue->Head, Node);
+    mpsc_node* Prev = (mpsc_node*)AtomicExchangePtrExplicit((void* volatile*)&Queue->Head, Node,
+                                                             ATOMIC_SEQ_CST);
     Prev->Next = Node;
+    _MPSCFreeListWake(Queue);
+}
+
+external void
+MPSCFreeListPushChain(mpsc_freelist* Queue, void* First, void* Last)
+{
+    mpsc_node* LastNode = (mpsc_node*)Last;
+    LastNode->Next = NULL;
+    mpsc_node* Prev = (mpsc_node*)AtomicExchangePtrExplicit((void* volatile*)&Queue->Head, LastNode,
+                                                             ATOMIC_SEQ_CST);
+    Prev->Next = (mpsc_node*)First;
+    _MPSCFreeListWake(Queue);
 }
 
 external mpsc_node*
@@ -42,7 +83,9 @@ MPSCFreeListPop(mpsc_freelist* Queue)
     mpsc_node* Head = Queue->Head;
     if (Tail != Head) return NULL;
     
-    MPSCFreeListPush(Queue, &Queue->Stub);
+    Queue->Stub.Next = NULL;
+    mpsc_node* Prev = (mpsc_node*)AtomicExchangePtr((void* volatile*)&Queue->Head, &Queue->Stub);
+    Prev->Next = &Queue->Stub;
     Next = Tail->Next;
     
     if (Next)
@@ -54,44 +97,821 @@ MPSCFreeListPop(mpsc_freelist* Queue)
     return NULL;
 }
 
+external mpsc_node*
+MPSCFreeListPopWait(mpsc_freelist* Queue, usz TimeoutMs)
+{
+    mpsc_node* Node = NULL;
+    for (i32 Spin = 0; !Node && Spin < QUEUE_SPIN_COUNT; Spin++)
+    {
+        Node = MPSCFreeListPop(Queue);
+        if (!Node) CpuPause();
+    }
+    if (Node || TimeoutMs == 0) return Node;
+    
+    timing Timer;
+    StartTiming(&Timer);
+    AtomicAddFetch32Explicit(&Queue->Waiters, 1, ATOMIC_SEQ_CST);
+    for (;;)
+    {
+        // The signal is read before checking the queue, so a push landing in between
+        // changes it and keeps the futex from sleeping.
+        i32 Signal = AtomicLoad32(&Queue->Signal);
+        Node = MPSCFreeListPop(Queue);
+        if (Node) break;
+        
+        if (AtomicLoadPtrExplicit((void* volatile*)&Queue->Head, ATOMIC_SEQ_CST) != Queue->Tail)
+        {
+            // A producer swapped [.Head] but hasn't linked its node yet; it's about to.
+            CpuPause();
+            continue;
+        }
+        
+        usz TimeLeft = _QueueTimeLeft(&Timer, TimeoutMs);
+        if (TimeLeft == 0) break;
+        WaitOnFutex(&Queue->Signal, Signal, TimeLeft);
+    }
+    AtomicAddFetch32(&Queue->Waiters, -1);
+    
+    return Node;
+}
+
+
+//==================
+// SPSC Ring Buffer
+//==================
+
+external bool
+InitSPSCRingBuffer(spsc_ringbuf* Queue, void* Buf, usz BufSize, usz ItemSize)
+{
+    usz NumItems = (ItemSize) ? BufSize / ItemSize : 0;
+    if (Buf && NumItems > 0)
+    {
+        Queue->Ring = (u8*)Buf;
+        Queue->ItemSize = ItemSize;
+        Queue->MaxCur = RoundDownToPow2(NumItems) - 1;
+        Queue->WriteCur = 0;
+        Queue->CachedReadCur = 0;
+        Queue->ReadCur = 0;
+        Queue->CachedWriteCur = 0;
+        return true;
+    }
+    return false;
+}
+
+internal u8*
+_SPSCRingBufferWriteSlot(spsc_ringbuf* Queue)
+{
+    usz WriteCur = Queue->WriteCur;
+    if (WriteCur - Queue->CachedReadCur > Queue->MaxCur)
+    {
+        Queue->CachedReadCur = AtomicLoadIsz(&Queue->ReadCur);
+        if (WriteCur - Queue->CachedReadCur > Queue->MaxCur)
+        {
+            return NULL;
+        }
+    }
+    return Queue->Ring + (WriteCur & Queue->MaxCur) * Queue->ItemSize;
+}
+
+internal u8*
+_SPSCRingBufferReadSlot(spsc_ringbuf* Queue)
+{
+    usz ReadCur = Queue->ReadCur;
+    if (ReadCur == Queue->CachedWriteCur)
+    {
+        Queue->CachedWriteCur = AtomicLoadIsz(&Queue->WriteCur);
+        if (ReadCur == Queue->CachedWriteCur)
+        {
+            return NULL;
+        }
+    }
+    return Queue->Ring + (ReadCur & Queue->MaxCur) * Queue->ItemSize;
+}
+
+external bool
+SPSCRingBufferPush(spsc_ringbuf* Queue, void* Item)
+{
+    void** Slot = (void**)_SPSCRingBufferWriteSlot(Queue);
+    if (Slot)
+    {
+        *Slot = Item;
+        AtomicStoreIsz(&Queue->WriteCur, Queue->WriteCur + 1);
+        return true;
+    }
+    return false;
+}
+
+external void*
+SPSCRingBufferPop(spsc_ringbuf* Queue)
+{
+    void* Item = NULL;
+    void** Slot = (void**)_SPSCRingBufferReadSlot(Queue);
+    if (Slot)
+    {
+        Item = *Slot;
+        AtomicStoreIsz(&Queue->ReadCur, Queue->ReadCur + 1);
+    }
+    return Item;
+}
+
+external bool
+SPSCRingBufferWrite(spsc_ringbuf* Queue, void* Record)
+{
+    u8* Slot = _SPSCRingBufferWriteSlot(Queue);
+    if (Slot)
+    {
+        memcpy(Slot, Record, Queue->ItemSize);
+        AtomicStoreIsz(&Queue->WriteCur, Queue->WriteCur + 1);
+        return true;
+    }
+    return false;
+}
+
+external bool
+SPSCRingBufferRead(spsc_ringbuf* Queue, void* Dst)
+{
+    u8* Slot = _SPSCRingBufferReadSlot(Queue);
+    if (Slot)
+    {
+        memcpy(Dst, Slot, Queue->ItemSize);
+        AtomicStoreIsz(&Queue->ReadCur, Queue->ReadCur + 1);
+        return true;
+    }
+    return false;
+}
+
+
+//=======================
+// Broadcast Ring Buffer
+//=======================
+
+external bool
+InitBroadcastRingBuffer(broadcast_ringbuf* Queue, void* Buf, usz BufSize, usz ItemSize, usz NumSubscribers)
+{
+    usz CursorsSize = NumSubscribers * sizeof(broadcast_cursor);
+    usz NumItems = (ItemSize && BufSize > CursorsSize) ? (BufSize - CursorsSize) / ItemSize : 0;
+    if (Buf && NumSubscribers > 0 && NumItems > 0)
+    {
+        Queue->Cursors = (broadcast_cursor*)Buf;
+        Queue->NumSubscribers = NumSubscribers;
+        Queue->Ring = (u8*)Buf + CursorsSize;
+        Queue->ItemSize = ItemSize;
+        Queue->MaxCur = RoundDownToPow2(NumItems) - 1;
+        Queue->WriteCur = 0;
+        Queue->CachedMinCur = 0;
+        for (usz Idx = 0; Idx < NumSubscribers; Idx++)
+        {
+            Queue->Cursors[Idx].ReadCur = 0;
+            Queue->Cursors[Idx].CachedWriteCur = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+external void*
+BroadcastRingBufferClaim(broadcast_ringbuf* Queue)
+{
+    usz WriteCur = Queue->WriteCur;
+    if (WriteCur - Queue->CachedMinCur > Queue->MaxCur)
+    {
+        // Gates on the slowest subscriber.
+        usz MinCur = WriteCur;
+        for (usz Idx = 0; Idx < Queue->NumSubscribers; Idx++)
+        {
+            usz ReadCur = AtomicLoadIsz(&Queue->Cursors[Idx].ReadCur);
+            if (ReadCur < MinCur) MinCur = ReadCur;
+        }
+        Queue->CachedMinCur = MinCur;
+        if (WriteCur - MinCur > Queue->MaxCur)
+        {
+            return NULL;
+        }
+    }
+    return Queue->Ring + (WriteCur & Queue->MaxCur) * Queue->ItemSize;
+}
+
+external void
+BroadcastRingBufferPublish(broadcast_ringbuf* Queue)
+{
+    AtomicStoreIsz(&Queue->WriteCur, Queue->WriteCur + 1);
+}
+
+external void*
+BroadcastRingBufferRead(broadcast_ringbuf* Queue, usz Subscriber)
+{
+    broadcast_cursor* Cursor = &Queue->Cursors[Subscriber];
+    usz ReadCur = Cursor->ReadCur;
+    if (ReadCur == Cursor->CachedWriteCur)
+    {
+        Cursor->CachedWriteCur = AtomicLoadIsz(&Queue->WriteCur);
+        if (ReadCur == Cursor->CachedWriteCur)
+        {
+            return NULL;
+        }
+    }
+    return Queue->Ring + (ReadCur & Queue->MaxCur) * Queue->ItemSize;
+}
+
+external void
+BroadcastRingBufferRelease(broadcast_ringbuf* Queue, usz Subscriber)
+{
+    broadcast_cursor* Cursor = &Queue->Cursors[Subscriber];
+    AtomicStoreIsz(&Cursor->ReadCur, Cursor->ReadCur + 1);
+}
+
 
 //==================
 // MPMC Ring Buffer
 //==================
 
-external mpmc_ringbuf
-InitMPMCRingBuffer(void** Ring, usz RingSize)
+external bool
+InitMPMCRingBuffer(mpmc_ringbuf* Queue, void* Buf, usz BufSize)
 {
-    mpmc_ringbuf Result = {0};
-    if (Ring)
+    usz NumCells = BufSize / sizeof(mpmc_cell);
+    if (Buf && NumCells > 0)
     {
-        RingSize = RoundDownToPow2(RingSize);
-        Result.Ring = Ring;
-        Result.MaxCur = (RingSize / sizeof(void*)) - 1;
+        NumCells = RoundDownToPow2(NumCells);
+        Queue->Ring = (mpmc_cell*)Buf;
+        Queue->MaxCur = NumCells - 1;
+        Queue->Waiters = 0;
+        Queue->WriteCur = 0;
+        Queue->ReadCur = 0;
+        for (usz Idx = 0; Idx < NumCells; Idx++)
+        {
+            Queue->Ring[Idx].Seq = Idx;
+            Queue->Ring[Idx].Item = NULL;
+        }
+        return true;
+    }
+    return false;
+}
+
+internal void
+_MPMCRingBufferWake(mpmc_ringbuf* Queue, usz Count)
+{
+    // Read after the compare-exchange on [.WriteCur], so either a consumer about to sleep
+    // sees the new cursor, or this sees its waiter count.
+    if (AtomicLoad32Explicit(&Queue->Waiters, ATOMIC_SEQ_CST) > 0)
+    {
+        WakeFutex(&Queue->WriteCur, Count > 1);
     }
-    return Result;
 }
 
 external bool
 MPMCRingBufferPush(mpmc_ringbuf* Queue, void* Item)
 {
-    if (AtomicCompareExchangePtr(&Queue->Ring[Queue->WriteCur & Queue->MaxCur], 0, Item))
+    usz WriteCur = AtomicLoadIsz(&Queue->WriteCur);
+    for (;;)
+    {
+        mpmc_cell* Cell = &Queue->Ring[WriteCur & Queue->MaxCur];
+        isz Diff = AtomicLoadIsz(&Cell->Seq) - (isz)WriteCur;
+        if (Diff == 0)
+        {
+            if (AtomicCompareExchangeIszExplicit(&Queue->WriteCur, WriteCur, WriteCur + 1,
+                                                 ATOMIC_SEQ_CST))
+            {
+                Cell->Item = Item;
+                AtomicStoreIsz(&Cell->Seq, WriteCur + 1);
+                _MPMCRingBufferWake(Queue, 1);
+                return true;
+            }
+        }
+        else if (Diff < 0)
+        {
+            return false; // Cell from previous lap not consumed yet, queue is full.
+        }
+        WriteCur = AtomicLoadIsz(&Queue->WriteCur);
+    }
+}
+
+external bool
+MPMCRingBufferTryPop(mpmc_ringbuf* Queue, void** Item)
+{
+    usz ReadCur = AtomicLoadIsz(&Queue->ReadCur);
+    for (;;)
+    {
+        mpmc_cell* Cell = &Queue->Ring[ReadCur & Queue->MaxCur];
+        isz Diff = AtomicLoadIsz(&Cell->Seq) - (isz)(ReadCur + 1);
+        if (Diff == 0)
+        {
+            if (AtomicCompareExchangeIsz(&Queue->ReadCur, ReadCur, ReadCur + 1))
+            {
+                *Item = Cell->Item;
+                AtomicStoreIsz(&Cell->Seq, ReadCur + Queue->MaxCur + 1);
+                return true;
+            }
+        }
+        else if (Diff < 0)
+        {
+            return false; // Cell not written to in this lap yet, queue is empty.
+        }
+        ReadCur = AtomicLoadIsz(&Queue->ReadCur);
+    }
+}
+
+external void*
+MPMCRingBufferPop(mpmc_ringbuf* Queue)
+{
+    void* Item = NULL;
+    MPMCRingBufferTryPop(Queue, &Item);
+    return Item;
+}
+
+external bool
+MPMCRingBufferPopWait(mpmc_ringbuf* Queue, void** Item, usz TimeoutMs)
+{
+    for (i32 Spin = 0; Spin < QUEUE_SPIN_COUNT; Spin++)
+    {
+        if (MPMCRingBufferTryPop(Queue, Item)) return true;
+        CpuPause();
+    }
+    if (TimeoutMs == 0) return false;
+    
+    bool Result = false;
+    timing Timer;
+    StartTiming(&Timer);
+    AtomicAddFetch32Explicit(&Queue->Waiters, 1, ATOMIC_SEQ_CST);
+    for (;;)
+    {
+        if (MPMCRingBufferTryPop(Queue, Item))
+        {
+            Result = true;
+            break;
+        }
+        
+        // Only sleeps if every claimed cell has also been read. Otherwise a producer is still
+        // writing its item, and will be done shortly.
+        usz WriteCur = AtomicLoadIszExplicit(&Queue->WriteCur, ATOMIC_SEQ_CST);
+        if (WriteCur != (usz)AtomicLoadIsz(&Queue->ReadCur))
+        {
+            CpuPause();
+            continue;
+        }
+        
+        usz TimeLeft = _QueueTimeLeft(&Timer, TimeoutMs);
+        if (TimeLeft == 0) break;
+        WaitOnFutex(&Queue->WriteCur, (i32)WriteCur, TimeLeft);
+    }
+    AtomicAddFetch32(&Queue->Waiters, -1);
+    
+    return Result;
+}
+
+external usz
+MPMCRingBufferPushN(mpmc_ringbuf* Queue, void** Items, usz Count)
+{
+    usz WriteCur = AtomicLoadIsz(&Queue->WriteCur);
+    for (;;)
+    {
+        // Counts how many cells in a row are free in this lap. A free cell can only be taken
+        // by whoever claims its cursor, so the count holds once the claim succeeds.
+        usz Free = 0;
+        for (; Free < Count && Free <= Queue->MaxCur; Free++)
+        {
+            mpmc_cell* Cell = &Queue->Ring[(WriteCur + Free) & Queue->MaxCur];
+            if (AtomicLoadIsz(&Cell->Seq) != (isz)(WriteCur + Free)) break;
+        }
+        
+        if (Free == 0)
+        {
+            mpmc_cell* Cell = &Queue->Ring[WriteCur & Queue->MaxCur];
+            if (AtomicLoadIsz(&Cell->Seq) - (isz)WriteCur < 0) return 0;
+        }
+        else if (AtomicCompareExchangeIszExplicit(&Queue->WriteCur, WriteCur, WriteCur + Free,
+                                                  ATOMIC_SEQ_CST))
+        {
+            for (usz Idx = 0; Idx < Free; Idx++)
+            {
+                mpmc_cell* Cell = &Queue->Ring[(WriteCur + Idx) & Queue->MaxCur];
+                Cell->Item = Items[Idx];
+                AtomicStoreIsz(&Cell->Seq, WriteCur + Idx + 1);
+            }
+            _MPMCRingBufferWake(Queue, Free);
+            return Free;
+        }
+        WriteCur = AtomicLoadIsz(&Queue->WriteCur);
+    }
+}
+
+external usz
+MPMCRingBufferPopN(mpmc_ringbuf* Queue, void** Items, usz MaxCount)
+{
+    usz ReadCur = AtomicLoadIsz(&Queue->ReadCur);
+    for (;;)
+    {
+        usz Ready = 0;
+        for (; Ready < MaxCount && Ready <= Queue->MaxCur; Ready++)
+        {
+            mpmc_cell* Cell = &Queue->Ring[(ReadCur + Ready) & Queue->MaxCur];
+            if (AtomicLoadIsz(&Cell->Seq) != (isz)(ReadCur + Ready + 1)) break;
+        }
+        
+        if (Ready == 0)
+        {
+            mpmc_cell* Cell = &Queue->Ring[ReadCur & Queue->MaxCur];
+            if (AtomicLoadIsz(&Cell->Seq) - (isz)(ReadCur + 1) < 0) return 0;
+        }
+        else if (AtomicCompareExchangeIsz(&Queue->ReadCur, ReadCur, ReadCur + Ready))
+        {
+            for (usz Idx = 0; Idx < Ready; Idx++)
+            {
+                mpmc_cell* Cell = &Queue->Ring[(ReadCur + Idx) & Queue->MaxCur];
+                Items[Idx] = Cell->Item;
+                AtomicStoreIsz(&Cell->Seq, ReadCur + Idx + Queue->MaxCur + 1);
+            }
+            return Ready;
+        }
+        ReadCur = AtomicLoadIsz(&Queue->ReadCur);
+    }
+}
+
+
+//============
+// MPMC Stack
+//============
+
+external void
+InitMPMCStack(mpmc_stack* Stack)
+{
+    Stack->Head = NULL;
+    Stack->Tag = 0;
+}
+
+external void
+MPMCStackPushChain(mpmc_stack* Stack, void* First, void* Last)
+{
+    mpsc_node* LastNode = (mpsc_node*)Last;
+    i64 Compare[2] = { (i64)AtomicLoadPtr((void* volatile*)&Stack->Head),
+        (i64)AtomicLoadIsz(&Stack->Tag) };
+    do
+    {
+        LastNode->Next = (mpsc_node*)Compare[0];
+    } while (!AtomicCompareExchange128(Stack, Compare, (i64)First, Compare[1] + 1));
+}
+
+external void
+MPMCStackPush(mpmc_stack* Stack, void* Item)
+{
+    MPMCStackPushChain(Stack, Item, Item);
+}
+
+internal void
+_LoadMPMCStack(mpmc_stack* Stack, i64 Snapshot[2])
+{
+    // The tag goes first: a pop landing between the two loads then leaves an old tag with
+    // the new head, which the tag checks catch, instead of a new tag with an old head.
+    Snapshot[1] = (i64)AtomicLoadIszExplicit(&Stack->Tag, ATOMIC_ACQUIRE);
+    Snapshot[0] = (i64)AtomicLoadPtrExplicit((void* volatile*)&Stack->Head, ATOMIC_ACQUIRE);
+}
+
+external mpsc_node*
+MPMCStackPopN(mpmc_stack* Stack, usz MaxCount, usz* Count)
+{
+    *Count = 0;
+    if (MaxCount == 0) return NULL;
+    
+    i64 Compare[2];
+    _LoadMPMCStack(Stack, Compare);
+    for (;;)
+    {
+        mpsc_node* First = (mpsc_node*)Compare[0];
+        if (!First) return NULL;
+        
+        // Every change to the stack bumps the tag, so if it's unchanged after reading a
+        // [Next], the node was still in the stack, and the pointer is safe to follow.
+        mpsc_node* Last = First;
+        usz Popped = 1;
+        bool Valid = true;
+        for (; Popped < MaxCount; Popped++)
+        {
+            mpsc_node* Next = (mpsc_node*)AtomicLoadPtr((void* volatile*)&Last->Next);
+            if (AtomicLoadIsz(&Stack->Tag) != Compare[1])
+            {
+                Valid = false;
+                break;
+            }
+            if (!Next) break;
+            Last = Next;
+        }
+        
+        if (Valid)
+        {
+            mpsc_node* Rest = Last->Next;
+            if (AtomicCompareExchange128(Stack, Compare, (i64)Rest, Compare[1] + 1))
+            {
+                Last->Next = NULL;
+                *Count = Popped;
+                return First;
+            }
+        }
+        else
+        {
+            _LoadMPMCStack(Stack, Compare);
+        }
+    }
+}
+
+external mpsc_node*
+MPMCStackPop(mpmc_stack* Stack)
+{
+    usz Count;
+    mpsc_node* Result = MPMCStackPopN(Stack, 1, &Count);
+    return Result;
+}
+
+external void
+InitStackMagazine(stack_magazine* Magazine, mpmc_stack* Depot, usz Capacity)
+{
+    Magazine->Depot = Depot;
+    Magazine->Items = NULL;
+    Magazine->Count = 0;
+    Magazine->Capacity = Max(Capacity, 2);
+}
+
+external void
+StackMagazinePush(stack_magazine* Magazine, void* Item)
+{
+    if (Magazine->Count == Magazine->Capacity)
+    {
+        usz Half = Magazine->Capacity / 2;
+        mpsc_node* First = Magazine->Items;
+        mpsc_node* Last = First;
+        for (usz Idx = 1; Idx < Half; Idx++)
+        {
+            Last = Last->Next;
+        }
+        Magazine->Items = Last->Next;
+        Magazine->Count -= Half;
+        MPMCStackPushChain(Magazine->Depot, First, Last);
+    }
+    
+    mpsc_node* Node = (mpsc_node*)Item;
+    Node->Next = Magazine->Items;
+    Magazine->Items = Node;
+    Magazine->Count++;
+}
+
+external mpsc_node*
+StackMagazinePop(stack_magazine* Magazine)
+{
+    if (!Magazine->Items)
+    {
+        Magazine->Items = MPMCStackPopN(Magazine->Depot, Magazine->Capacity / 2, &Magazine->Count);
+        if (!Magazine->Items) return NULL;
+    }
+    
+    mpsc_node* Node = Magazine->Items;
+    Magazine->Items = Node->Next;
+    Magazine->Count--;
+    return Node;
+}
+
+external void
+FlushStackMagazine(stack_magazine* Magazine)
+{
+    if (Magazine->Items)
     {
-        AtomicAddFetchIsz(&Queue->WriteCur, 1);
+        mpsc_node* Last = Magazine->Items;
+        while (Last->Next)
+        {
+            Last = Last->Next;
+        }
+        MPMCStackPushChain(Magazine->Depot, Magazine->Items, Last);
+        Magazine->Items = NULL;
+        Magazine->Count = 0;
+    }
+}
+
+
+//====================
+// Work-Stealing Deque
+//====================
+
+external bool
+InitWSDeque(ws_deque* Queue, void* Buf, usz BufSize)
+{
+    usz NumItems = BufSize / sizeof(void*);
+    if (Buf && NumItems > 0)
+    {
+        Queue->Ring = (void**)Buf;
+        Queue->MaxCur = RoundDownToPow2(NumItems) - 1;
+        Queue->Top = 0;
+        Queue->Bottom = 0;
         return true;
     }
     return false;
 }
 
+external bool
+WSDequePush(ws_deque* Queue, void* Item)
+{
+    isz Bottom = AtomicLoadIsz(&Queue->Bottom);
+    isz Top = AtomicLoadIsz(&Queue->Top);
+    if (Bottom - Top > (isz)Queue->MaxCur)
+    {
+        return false;
+    }
+    AtomicStorePtr(&Queue->Ring[Bottom & Queue->MaxCur], Item);
+    AtomicStoreIsz(&Queue->Bottom, Bottom + 1);
+    return true;
+}
+
 external void*
-MPMCRingBufferPop(mpmc_ringbuf* Queue)
+WSDequePop(ws_deque* Queue)
 {
-    void* Item = Queue->Ring[Queue->ReadCur & Queue->MaxCur];
-    if (Item
-        && AtomicCompareExchangePtr(&Queue->Ring[Queue->ReadCur & Queue->MaxCur], Item, 0))
+    // The exchange works as a full barrier, so [.Bottom] is visible to thieves before [.Top]
+    // is read. A release store would let both sides miss each other on the last item.
+    isz Bottom = AtomicLoadIszExplicit(&Queue->Bottom, ATOMIC_RELAXED) - 1;
+    AtomicExchangeIszExplicit(&Queue->Bottom, Bottom, ATOMIC_SEQ_CST);
+    isz Top = AtomicLoadIszExplicit(&Queue->Top, ATOMIC_SEQ_CST);
+    
+    void* Item = NULL;
+    if (Top <= Bottom)
     {
-        AtomicAddFetchIsz(&Queue->ReadCur, 1);
-        return Item;
+        Item = AtomicLoadPtr(&Queue->Ring[Bottom & Queue->MaxCur]);
+        if (Top == Bottom)
+        {
+            if (!AtomicCompareExchangeIszExplicit(&Queue->Top, Top, Top + 1, ATOMIC_SEQ_CST))
+            {
+                Item = NULL; // A thief took the last item first.
+            }
+            AtomicStoreIsz(&Queue->Bottom, Bottom + 1);
+        }
     }
-    return 0;
+    else
+    {
+        AtomicStoreIsz(&Queue->Bottom, Bottom + 1);
+    }
+    return Item;
+}
+
+external void*
+WSDequeSteal(ws_deque* Queue)
+{
+    // Seq_cst on both sides of the race for the last item, so the thief and the owner can't
+    // both miss each other's update. On x64 these loads are still plain moves.
+    isz Top = AtomicLoadIszExplicit(&Queue->Top, ATOMIC_SEQ_CST);
+    isz Bottom = AtomicLoadIszExplicit(&Queue->Bottom, ATOMIC_SEQ_CST);
+    if (Top < Bottom)
+    {
+        void* Item = AtomicLoadPtr(&Queue->Ring[Top & Queue->MaxCur]);
+        if (AtomicCompareExchangeIszExplicit(&Queue->Top, Top, Top + 1, ATOMIC_SEQ_CST))
+        {
+            return Item;
+        }
+    }
+    return NULL;
+}
+
+
+//===================
+// Epoch Reclamation
+//===================
+
+external bool
+InitEpochDomain(epoch_domain* Domain, void* Buf, usz BufSize, epoch_reclaim_proc Reclaim, void* Arg)
+{
+    usz NumRecords = BufSize / sizeof(epoch_record);
+    if (Buf && NumRecords > 0)
+    {
+        memset(Buf, 0, NumRecords * sizeof(epoch_record));
+        Domain->Epoch = 0;
+        Domain->Records = (epoch_record*)Buf;
+        Domain->NumRecords = NumRecords;
+        Domain->Reclaim = Reclaim;
+        Domain->ReclaimArg = Arg;
+        return true;
+    }
+    return false;
+}
+
+internal void
+_ReclaimEpochSlot(epoch_domain* Domain, epoch_record* Record, usz Slot)
+{
+    if (Record->First[Slot])
+    {
+        Domain->Reclaim(Record->First[Slot], Record->Last[Slot], Domain->ReclaimArg);
+        Record->First[Slot] = NULL;
+        Record->Last[Slot] = NULL;
+        Record->NumRetired[Slot] = 0;
+    }
+}
+
+external void
+CloseEpochDomain(epoch_domain* Domain)
+{
+    for (usz Idx = 0; Idx < Domain->NumRecords; Idx++)
+    {
+        for (usz Slot = 0; Slot < 3; Slot++)
+        {
+            _ReclaimEpochSlot(Domain, &Domain->Records[Idx], Slot);
+        }
+    }
+}
+
+external epoch_record*
+AcquireEpochRecord(epoch_domain* Domain)
+{
+    for (usz Idx = 0; Idx < Domain->NumRecords; Idx++)
+    {
+        epoch_record* Record = &Domain->Records[Idx];
+        if (AtomicLoadIszExplicit(&Record->InUse, ATOMIC_RELAXED) == 0
+            && AtomicCompareExchangeIsz(&Record->InUse, 0, 1))
+        {
+            return Record;
+        }
+    }
+    return NULL;
+}
+
+external void
+ReleaseEpochRecord(epoch_domain* Domain, epoch_record* Record)
+{
+    CollectEpoch(Domain, Record);
+    AtomicStoreIsz(&Record->InUse, 0);
+}
+
+external void
+EnterEpoch(epoch_domain* Domain, epoch_record* Record)
+{
+    // The exchange is a full barrier, so the record is announced before any pointer in the
+    // structure is read. If the epoch advances in between, the record just holds it back.
+    usz Epoch = AtomicLoadIszExplicit(&Domain->Epoch, ATOMIC_RELAXED);
+    AtomicExchangeIszExplicit(&Record->State, (Epoch << 1) | 1, ATOMIC_SEQ_CST);
+}
+
+external void
+ExitEpoch(epoch_record* Record)
+{
+    AtomicStoreIsz(&Record->State, 0);
+}
+
+internal void
+_TryAdvanceEpoch(epoch_domain* Domain)
+{
+    usz Epoch = AtomicLoadIszExplicit(&Domain->Epoch, ATOMIC_SEQ_CST);
+    for (usz Idx = 0; Idx < Domain->NumRecords; Idx++)
+    {
+        usz State = AtomicLoadIszExplicit(&Domain->Records[Idx].State, ATOMIC_SEQ_CST);
+        if ((State & 1) && (State >> 1) != Epoch)
+        {
+            return; // Some thread is still in the previous epoch.
+        }
+    }
+    AtomicCompareExchangeIszExplicit(&Domain->Epoch, Epoch, Epoch + 1, ATOMIC_SEQ_CST);
+}
+
+external void
+CollectEpoch(epoch_domain* Domain, epoch_record* Record)
+{
+    _TryAdvanceEpoch(Domain);
+    usz Epoch = AtomicLoadIszExplicit(&Domain->Epoch, ATOMIC_SEQ_CST);
+    for (usz Slot = 0; Slot < 3; Slot++)
+    {
+        if (Record->RetiredEpoch[Slot] + 2 <= Epoch)
+        {
+            _ReclaimEpochSlot(Domain, Record, Slot);
+        }
+    }
+}
+
+external void
+RetireEpochNode(epoch_domain* Domain, epoch_record* Record, void* Node)
+{
+    // Read after the node was unlinked, so any thread that can still reach it is in this
+    // epoch or the one before.
+    usz Epoch = AtomicLoadIszExplicit(&Domain->Epoch, ATOMIC_SEQ_CST);
+    usz Slot = Epoch % 3;
+    if (Record->RetiredEpoch[Slot] != Epoch)
+    {
+        _ReclaimEpochSlot(Domain, Record, Slot); // Holds nodes from three epochs ago.
+        Record->RetiredEpoch[Slot] = Epoch;
+        Record->NextCollect = 0; // The epoch moved, so collecting may free more now.
+    }
+    
+    mpsc_node* RetiredNode = (mpsc_node*)Node;
+    RetiredNode->Next = Record->First[Slot];
+    Record->First[Slot] = RetiredNode;
+    if (!Record->Last[Slot])
+    {
+        Record->Last[Slot] = RetiredNode;
+    }
+    Record->NumRetired[Slot]++;
+    
+    usz NumRetired = Record->NumRetired[0] + Record->NumRetired[1] + Record->NumRetired[2];
+    if (NumRetired >= Max(Record->NextCollect, EPOCH_RETIRE_THRESHOLD))
+    {
+        // Each try reads every record in the domain, so while a slow thread holds the epoch
+        // back, it's only retried after another batch of nodes instead of on every one.
+        CollectEpoch(Domain, Record);
+        NumRetired = Record->NumRetired[0] + Record->NumRetired[1] + Record->NumRetired[2];
+        Record->NextCollect = NumRetired + EPOCH_RETIRE_THRESHOLD;
+    }
+}
+
+external void
+RecycleIntoMPSCFreeList(mpsc_node* First, mpsc_node* Last, void* Arg)
+{
+    MPSCFreeListPushChain((mpsc_freelist*)Arg, First, Last);
 }
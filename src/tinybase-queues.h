@@ -10,6 +10,8 @@
 #include "tinybase-types.h"
 #include "tinybase-atomic.h"
 
+#include <string.h>
+
 
 //========================================
 // Multiple Producers Single Consumer
@@ -38,11 +40,15 @@ typedef struct mpsc_freelist
     mpsc_node* volatile Head;
     mpsc_node* Tail;
     mpsc_node  Stub;
+    i32 Waiters;
+    i32 Signal;
 } mpsc_freelist;
 
 /* The queue structure works as a free list. It does not actually store the data, only
  |  pointers to it. The data can be stored wherever and however, its memory layout does not
- |  matter to the queue (or to the thread-safe aspect of the code). */
+ |  matter to the queue (or to the thread-safe aspect of the code). [.Waiters] counts the
+ |  consumers sleeping in MPSCFreeListPopWait(), and [.Signal] is the word they sleep on;
+ |  producers only touch it when [.Waiters] is non-zero. */
 
 external void InitMPSCFreeList(mpsc_freelist* Queue);
 
@@ -55,47 +61,470 @@ external void MPSCFreeListPush(mpsc_freelist* Queue, void* Item);
  |  mpsc_node, as described above. There is no limit to how many nodes can be pushed into it.
  |--- Return: nothing. */
 
+external void MPSCFreeListPushChain(mpsc_freelist* Queue, void* First, void* Last);
+
+/* Pushes a chain of nodes, already linked from [First] to [Last] through their [Next]
+ |  pointers, into the queue with a single atomic exchange. [First] and [Last] may be the same
+ |  node. The [Next] pointer of [Last] is reset by the function.
+ |--- Return: nothing. */
+
 external mpsc_node* MPSCFreeListPop(mpsc_freelist* Queue);
 
 /* Pops a node from [Queue] and returns it. Return pointer should be cast to the structure
  |  inserted in the queue.
  |--- Return: next node in the queue, or NULL if no node remaining. */
 
+external mpsc_node* MPSCFreeListPopWait(mpsc_freelist* Queue, usz TimeoutMs);
+
+/* Same as MPSCFreeListPop(), but if the queue is empty it blocks until a node is pushed,
+ |  or until [TimeoutMs] milliseconds have passed (TIMEOUT_INFINITE waits forever). It spins
+ |  for a short while first, and only then goes to sleep on a futex.
+ |--- Return: next node in the queue, or NULL if timed out. */
+
+
+//========================================
+// Single Producer Single Consumer
+//========================================
+
+typedef struct spsc_ringbuf
+{
+    u8* Ring;
+    usz ItemSize;
+    usz MaxCur;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(u8*) - 2*sizeof(usz)];
+    usz WriteCur;
+    usz CachedReadCur;
+    u8 _Pad1[CACHE_LINE_SIZE - 2*sizeof(usz)];
+    usz ReadCur;
+    usz CachedWriteCur;
+    u8 _Pad2[CACHE_LINE_SIZE - 2*sizeof(usz)];
+} spsc_ringbuf;
+
+/* This queue structure works as a bounded ring buffer for exactly one producer thread and
+ |  one consumer thread. [.Ring] holds fixed-size records of [.ItemSize] bytes, which can be
+ |  pointers (ItemSize of sizeof(void*)) or any inline struct. The producer owns [.WriteCur]
+ |  and the consumer owns [.ReadCur], each on its own cache line, and each side keeps a cached
+ |  copy of the other's cursor, so it only reads the shared line when the cached value says
+ |  the queue is full (or empty). No operation uses atomic read-modify-write instructions. */
+
+external bool InitSPSCRingBuffer(spsc_ringbuf* Queue, void* Buf, usz BufSize, usz ItemSize);
+
+/* Sets up [Queue] to use [Buf] as storage for records of [ItemSize] bytes. [Buf] must have
+ |  been pre-allocated by the application to [BufSize] number of bytes. The number of records
+ |  (BufSize / ItemSize) is rounded down to the nearest power of two.
+|--- Return: true if successful, false if [Buf] can't fit a single record. */
+
+external bool SPSCRingBufferPush(spsc_ringbuf* Queue, void* Item);
+
+/* Pushes pointer [Item] into the queue, so long as there's space in the buffer for it.
+ |  [Queue] must have been initialized with ItemSize of sizeof(void*). Producer only.
+|--- Return: true if successful, false if queue is full. */
+
+external void* SPSCRingBufferPop(spsc_ringbuf* Queue);
+
+/* Pops a pointer from the queue. [Queue] must have been initialized with ItemSize of
+ |  sizeof(void*). Consumer only.
+|--- Return: pointer to item if successful, NULL pointer if queue is empty. */
+
+external bool SPSCRingBufferWrite(spsc_ringbuf* Queue, void* Record);
+
+/* Copies [.ItemSize] bytes from [Record] into the queue, so long as there's space in the
+ |  buffer for it. Producer only.
+|--- Return: true if successful, false if queue is full. */
+
+external bool SPSCRingBufferRead(spsc_ringbuf* Queue, void* Dst);
+
+/* Copies the next record in the queue into [Dst], which must have at least [.ItemSize]
+ |  bytes. Consumer only.
+|--- Return: true if successful, false if queue is empty. */
+
+
+//========================================
+// Single Producer Broadcast
+//========================================
+
+typedef struct broadcast_cursor
+{
+    usz ReadCur;
+    usz CachedWriteCur;
+    u8 _Pad0[CACHE_LINE_SIZE - 2*sizeof(usz)];
+} broadcast_cursor;
+
+typedef struct broadcast_ringbuf
+{
+    u8* Ring;
+    usz ItemSize;
+    usz MaxCur;
+    broadcast_cursor* Cursors;
+    usz NumSubscribers;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(u8*) - sizeof(broadcast_cursor*) - 3*sizeof(usz)];
+    usz WriteCur;
+    usz CachedMinCur;
+    u8 _Pad1[CACHE_LINE_SIZE - 2*sizeof(usz)];
+} broadcast_ringbuf;
+
+/* This queue structure works as a bounded ring buffer for one producer thread and a fixed
+ |  number of subscribers, where every subscriber sees every item (like a disruptor). [.Ring]
+ |  holds fixed-size records of [.ItemSize] bytes. Each subscriber has its own cursor in
+ |  [.Cursors], on its own cache line, and the producer can only reuse a slot once the
+ |  slowest subscriber has released it. Items are written and read in place, so they're
+ |  never copied by the queue. Each side keeps a cached copy of the other's cursors, and only
+ |  reads the shared lines when the cached values say the queue is full (or empty). */
+
+external bool InitBroadcastRingBuffer(broadcast_ringbuf* Queue, void* Buf, usz BufSize, usz ItemSize, usz NumSubscribers);
+
+/* Sets up [Queue] for [NumSubscribers] subscribers, using [Buf] as storage. [Buf] must have
+ |  been pre-allocated by the application to [BufSize] number of bytes, and should be aligned
+ |  to CACHE_LINE_SIZE. The subscriber cursors are put at the start of [Buf], and the rest is
+ |  used for records of [ItemSize] bytes, whose number is rounded down to the nearest power
+ |  of two.
+|--- Return: true if successful, false if [Buf] can't fit the cursors and a single record. */
+
+external void* BroadcastRingBufferClaim(broadcast_ringbuf* Queue);
+
+/* Gets the slot for the next record, for the producer to write into directly. The record
+ |  only becomes visible to subscribers after BroadcastRingBufferPublish() is called.
+ |  Calling this again before publishing returns the same slot. Producer only.
+|--- Return: pointer to slot of [.ItemSize] bytes, or NULL if queue is full. */
+
+external void BroadcastRingBufferPublish(broadcast_ringbuf* Queue);
+
+/* Makes the record written to the slot from BroadcastRingBufferClaim() visible to all
+ |  subscribers. Producer only.
+|--- Return: nothing. */
+
+external void* BroadcastRingBufferRead(broadcast_ringbuf* Queue, usz Subscriber);
+
+/* Gets the next record for subscriber number [Subscriber], in place. The record stays valid
+ |  until the subscriber calls BroadcastRingBufferRelease(), and calling this again before
+ |  that returns the same record. Each subscriber number must only be used by one thread.
+|--- Return: pointer to record, or NULL if there's no new record for the subscriber. */
+
+external void BroadcastRingBufferRelease(broadcast_ringbuf* Queue, usz Subscriber);
+
+/* Marks the record from BroadcastRingBufferRead() as done for subscriber [Subscriber], so
+ |  the producer can reuse its slot once all other subscribers are done with it too. Must
+ |  only be called after BroadcastRingBufferRead() returned a record.
+|--- Return: nothing. */
+
 
 //========================================
 // Multiple Producers Multiple Consumers
 //========================================
 
+typedef struct mpmc_cell
+{
+    usz Seq;
+    void* Item;
+} mpmc_cell;
+
+/* Slot of the ring buffer. [.Seq] tells the lap the slot is in: a producer may only write
+ |  to it when it equals the write cursor, and a consumer may only read from it when it
+ |  equals the read cursor plus one. */
+
 typedef struct mpmc_ringbuf
 {
-    void** Ring;
+    mpmc_cell* Ring;
     usz MaxCur;
-    usz ReadCur;
+    i32 Waiters;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(mpmc_cell*) - sizeof(usz) - sizeof(i32)];
     usz WriteCur;
+    u8 _Pad1[CACHE_LINE_SIZE - sizeof(usz)];
+    usz ReadCur;
+    u8 _Pad2[CACHE_LINE_SIZE - sizeof(usz)];
 } mpmc_ringbuf;
 
-/* This queue structure works as a ring buffer. [.Buf] is an array of pointers that works
-|  circularly, with elements added at [.WriteCur] and read from [.ReadCur]. Both cursors wrap
-|  at the end of the array, which is what makes it work circularly. [.WriteCur] will never
- |  overwrite the current [.ReadCur], nor will [.ReadCur] read past the current [.WriteCur]. */
+/* This queue structure works as a bounded ring buffer. [.Ring] is an array of cells that
+|  works circularly, with elements added at [.WriteCur] and read from [.ReadCur]. Both
+ |  cursors only ever grow, and are masked by [.MaxCur] to find the cell. A cursor is claimed
+ |  with a single compare-exchange, and the cell's [.Seq] is what hands the item over from
+ |  producer to consumer, so threads never spin on the same cell. Each cursor sits on its own
+ |  cache line, to avoid producers and consumers invalidating each other. [.Waiters] counts
+ |  the consumers sleeping in MPMCRingBufferPopWait(), so producers only make the wake-up
+ |  syscall when someone is actually asleep. */
 
-external mpmc_ringbuf InitMPMCRingBuffer(void** Buf, usz BufSize);
+external bool InitMPMCRingBuffer(mpmc_ringbuf* Queue, void* Buf, usz BufSize);
 
-/* Creates and sets up the structure. [Buf] must have been pre-allocated by the application
-|  to [BufSize] number of bytes, and must be zeroed. If [BufSize] is not a power of two,
- |  this function will round it down to the nearest power.
-|--- Return: initiated mpmc_ringbuf struct. */
+/* Sets up [Queue] to use [Buf] as storage. [Buf] must have been pre-allocated by the
+ |  application to [BufSize] number of bytes, and be aligned to at least pointer size. The
+ |  number of cells (BufSize / sizeof(mpmc_cell)) is rounded down to the nearest power of two.
+|--- Return: true if successful, false if [Buf] can't fit a single cell. */
 
 external bool MPMCRingBufferPush(mpmc_ringbuf* Queue, void* Item);
 
-/* Pushes a new [Item] into the queue, so long as there's space in the buffer for it.
-|--- Return: true if successful, false if not. */
+/* Pushes a new [Item] into the queue, so long as there's space in the buffer for it. [Item]
+ |  may be any value, including NULL.
+|--- Return: true if successful, false if queue is full. */
 
 external void* MPMCRingBufferPop(mpmc_ringbuf* Queue);
 
-/* Pops an item from the queue. If there are no more items to pop, it will return NULL.
+/* Pops an item from the queue. If there are no more items to pop, it will return NULL. If
+ |  NULL items are pushed, use MPMCRingBufferTryPop() instead, to tell them apart.
 |--- Return: pointer to item if successful, NULL pointer if not. */
 
+external bool MPMCRingBufferTryPop(mpmc_ringbuf* Queue, void** Item);
+
+/* Pops an item from the queue into [Item].
+|--- Return: true if successful, false if queue is empty. */
+
+external bool MPMCRingBufferPopWait(mpmc_ringbuf* Queue, void** Item, usz TimeoutMs);
+
+/* Pops an item from the queue into [Item]. If the queue is empty, it blocks until an item
+ |  is pushed, or until [TimeoutMs] milliseconds have passed (TIMEOUT_INFINITE waits forever).
+ |  It spins for a short while first, and only then goes to sleep on a futex keyed on
+ |  [.WriteCur].
+|--- Return: true if successful, false if timed out. */
+
+external usz MPMCRingBufferPushN(mpmc_ringbuf* Queue, void** Items, usz Count);
+
+/* Pushes up to [Count] items from the [Items] array into the queue, reserving a contiguous
+ |  range of cells with a single atomic operation. Items are pushed in array order, and fewer
+ |  than [Count] are pushed if the queue doesn't have space for all of them.
+|--- Return: number of items pushed. */
+
+external usz MPMCRingBufferPopN(mpmc_ringbuf* Queue, void** Items, usz MaxCount);
+
+/* Pops up to [MaxCount] items from the queue into the [Items] array, reserving a contiguous
+ |  range of cells with a single atomic operation.
+|--- Return: number of items popped. */
+
+
+//========================================
+// Multiple Producers Multiple Consumers Stack
+//========================================
+
+typedef struct align_as(16) mpmc_stack
+{
+    mpsc_node* Head;
+    usz Tag;
+} mpmc_stack;
+
+/* Intrusive lock-free stack (Treiber stack), that any number of threads can push into and
+ |  pop from. Nodes are the same as in mpsc_freelist. [.Head] and [.Tag] are swapped together
+ |  with a 128-bit compare-exchange, and [.Tag] changes on every operation, so a pop can't
+ |  succeed on a head that was popped and pushed back in the meantime (the ABA problem).
+ |  Popping reads the [Next] of nodes that another thread may have just popped, so the memory
+ |  of nodes must stay valid while the stack is in use (e.g. objects in a pool); to release
+ |  it, go through epoch reclamation. x64 only. */
+
+external void InitMPMCStack(mpmc_stack* Stack);
+
+/* Prepares a new stack to be used. Must be called before using it.
+ |--- Return: nothing. */
+
+external void MPMCStackPush(mpmc_stack* Stack, void* Item);
+
+/* Pushes node [Item] into the stack.
+ |--- Return: nothing. */
+
+external void MPMCStackPushChain(mpmc_stack* Stack, void* First, void* Last);
+
+/* Pushes a chain of nodes, already linked from [First] to [Last] through their [Next]
+ |  pointers, with a single atomic operation. [First] ends up on top.
+ |--- Return: nothing. */
+
+external mpsc_node* MPMCStackPop(mpmc_stack* Stack);
+
+/* Pops the node on top of the stack.
+ |--- Return: pointer to node, or NULL if stack is empty. */
+
+external mpsc_node* MPMCStackPopN(mpmc_stack* Stack, usz MaxCount, usz* Count);
+
+/* Pops up to [MaxCount] nodes from the top of the stack with a single atomic operation, and
+ |  writes how many were popped to [Count]. The nodes are returned linked through their
+ |  [Next] pointers, with the [Next] of the last one set to NULL.
+ |--- Return: first node of the chain, or NULL if stack is empty. */
+
+
+typedef struct stack_magazine
+{
+    mpmc_stack* Depot;
+    mpsc_node* Items;
+    usz Count;
+    usz Capacity;
+} stack_magazine;
+
+/* Per-thread cache of nodes in front of a shared mpmc_stack, [.Depot]. Nodes are pushed and
+ |  popped from the local [.Items] chain, without atomics, and only move to or from the depot
+ |  in batches of half the [.Capacity], when the magazine is full or empty. Must only be used
+ |  by one thread. */
+
+external void InitStackMagazine(stack_magazine* Magazine, mpmc_stack* Depot, usz Capacity);
+
+/* Sets up [Magazine] in front of [Depot], caching at most [Capacity] nodes (minimum of 2).
+ |--- Return: nothing. */
+
+external void StackMagazinePush(stack_magazine* Magazine, void* Item);
+
+/* Puts node [Item] into the magazine. If it's full, half of its nodes are moved to the
+ |  depot first.
+ |--- Return: nothing. */
+
+external mpsc_node* StackMagazinePop(stack_magazine* Magazine);
+
+/* Takes a node from the magazine. If it's empty, it's refilled from the depot first.
+ |--- Return: pointer to node, or NULL if both the magazine and the depot are empty. */
+
+external void FlushStackMagazine(stack_magazine* Magazine);
+
+/* Moves all nodes in the magazine back to the depot, e.g. before the thread exits.
+ |--- Return: nothing. */
+
+
+//========================================
+// Work-Stealing Deque
+//========================================
+
+typedef struct ws_deque
+{
+    void** Ring;
+    usz MaxCur;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(void**) - sizeof(usz)];
+    isz Top;
+    u8 _Pad1[CACHE_LINE_SIZE - sizeof(isz)];
+    isz Bottom;
+    u8 _Pad2[CACHE_LINE_SIZE - sizeof(isz)];
+} ws_deque;
+
+/* This structure is a bounded Chase-Lev deque. It has a single owner thread, that pushes
+ |  and pops items at [.Bottom] in LIFO order, while any number of other threads can steal
+ |  items from [.Top] in FIFO order. The owner only pays for an atomic read-modify-write when
+ |  it competes with a thief for the last item. Items must not be NULL. */
+
+external bool InitWSDeque(ws_deque* Queue, void* Buf, usz BufSize);
+
+/* Sets up [Queue] to use [Buf] as storage. [Buf] must have been pre-allocated by the
+ |  application to [BufSize] number of bytes. The number of items (BufSize / sizeof(void*)) is
+ |  rounded down to the nearest power of two.
+|--- Return: true if successful, false if [Buf] can't fit a single item. */
+
+external bool WSDequePush(ws_deque* Queue, void* Item);
+
+/* Pushes [Item] at the bottom of [Queue]. Must only be called by the owner thread.
+|--- Return: true if successful, false if deque is full. */
+
+external void* WSDequePop(ws_deque* Queue);
+
+/* Pops the most recently pushed item from the bottom of [Queue]. Must only be called by the
+ |  owner thread.
+|--- Return: pointer to item if successful, NULL pointer if deque is empty. */
+
+external void* WSDequeSteal(ws_deque* Queue);
+
+/* Steals the oldest item from the top of [Queue]. Can be called by any thread. It may fail
+ |  spuriously when racing other thieves or the owner for the same item.
+|--- Return: pointer to item if successful, NULL pointer if not. */
+
+
+//========================================
+// Epoch Reclamation
+//========================================
+
+#define EPOCH_RETIRE_THRESHOLD 64
+
+#define EPOCH_RECLAIM_PROC(Name) void Name(mpsc_node* First, mpsc_node* Last, void* Arg)
+typedef void (*epoch_reclaim_proc)(mpsc_node*, mpsc_node*, void*);
+
+/* Callback that receives nodes once it's safe to free them, as a chain linked through their
+ |  [Next] pointers, from [First] to [Last]. [Arg] is the one passed to InitEpochDomain(). */
+
+typedef struct epoch_record
+{
+    usz State;
+    usz InUse;
+    mpsc_node* First[3];
+    mpsc_node* Last[3];
+    usz RetiredEpoch[3];
+    usz NumRetired[3];
+    usz NextCollect;
+    u8 _Pad0[2*CACHE_LINE_SIZE - 15*sizeof(usz)];
+} epoch_record;
+
+/* Per-thread state. [.State] holds the epoch the thread saw when it entered a critical
+ |  section, shifted left by one, with the lowest bit set while it's inside. Nodes the thread
+ |  retires go in one of three lists, by the global epoch at the time they were retired.
+ |  [.NextCollect] is the number of retired nodes at which CollectEpoch() is tried again. */
+
+typedef struct epoch_domain
+{
+    usz Epoch;
+    u8 _Pad0[CACHE_LINE_SIZE - sizeof(usz)];
+    epoch_record* Records;
+    usz NumRecords;
+    epoch_reclaim_proc Reclaim;
+    void* ReclaimArg;
+} epoch_domain;
+
+/* Epoch-based reclamation, for freeing nodes removed from lock-free structures while other
+ |  threads may still be reading them. Threads wrap their accesses to the structure between
+ |  EnterEpoch() and ExitEpoch(), and hand removed nodes to RetireEpochNode() instead of
+ |  freeing them. [.Epoch] only advances once every thread inside a critical section has
+ |  seen the current one, so a node retired in epoch E can't be reached by anyone once the
+ |  epoch gets to E+2, and is then passed to [.Reclaim] in a batch.
+|
+|  Retired nodes must start with an mpsc_node, like the ones in mpsc_freelist, and that
+|  [Next] pointer is overwritten to chain them. Only retire a node after it has been
+|  unlinked from the structure. */
+
+external bool InitEpochDomain(epoch_domain* Domain, void* Buf, usz BufSize, epoch_reclaim_proc Reclaim, _opt void* Arg);
+
+/* Sets up [Domain] to use [Buf] as storage for its thread records. [Buf] must have been
+ |  pre-allocated by the application to [BufSize] number of bytes, and there's one record
+ |  per sizeof(epoch_record) bytes, which limits how many threads can use the domain at the
+ |  same time. Nodes that are safe to free are passed to [Reclaim] with [Arg]; to recycle
+ |  them, pass RecycleIntoMPSCFreeList with an mpsc_freelist as [Arg].
+|--- Return: true if successful, false if [Buf] can't fit a single record. */
+
+external void CloseEpochDomain(epoch_domain* Domain);
+
+/* Passes all nodes still waiting in [Domain] to its reclaim callback. No thread can be
+ |  inside a critical section, or use the domain afterwards.
+|--- Return: nothing. */
+
+external epoch_record* AcquireEpochRecord(epoch_domain* Domain);
+
+/* Claims a free record in [Domain] for the calling thread. It must be passed to the other
+ |  functions by the same thread, until released.
+|--- Return: pointer to record, or NULL if all records are taken. */
+
+external void ReleaseEpochRecord(epoch_domain* Domain, epoch_record* Record);
+
+/* Returns [Record] to [Domain]. Must be called outside a critical section. Nodes that
+ |  can't be freed yet stay in the record, and are handled by its next owner.
+|--- Return: nothing. */
+
+external void EnterEpoch(epoch_domain* Domain, epoch_record* Record);
+
+/* Starts a critical section. Nodes reachable from the structure after this call won't be
+ |  freed until ExitEpoch() is called. Costs a single atomic exchange.
+|--- Return: nothing. */
+
+external void ExitEpoch(epoch_record* Record);
+
+/* Ends a critical section started with EnterEpoch(). Pointers read from the structure
+ |  inside it must not be used anymore.
+|--- Return: nothing. */
+
+external void RetireEpochNode(epoch_domain* Domain, epoch_record* Record, void* Node);
+
+/* Hands [Node], already unlinked from the structure, over to be freed once no thread can
+ |  be reading it. Once the record holds EPOCH_RETIRE_THRESHOLD nodes, it also calls
+ |  CollectEpoch(); if a slow thread keeps nodes from being freed, it only tries again after
+ |  another EPOCH_RETIRE_THRESHOLD nodes are retired, or after the epoch advances.
+|--- Return: nothing. */
+
+external void CollectEpoch(epoch_domain* Domain, epoch_record* Record);
+
+/* Tries to advance the epoch of [Domain], and passes the nodes retired through [Record]
+ |  that became safe to the reclaim callback.
+|--- Return: nothing. */
+
+external void RecycleIntoMPSCFreeList(mpsc_node* First, mpsc_node* Last, void* Arg);
+
+/* Reclaim callback that pushes the nodes into the mpsc_freelist passed as [Arg], so they
+ |  can be reused instead of freed.
+|--- Return: nothing. */
+
 
 #if !defined(TT_STATIC_LINKING)
 #include "tinybase-queues.c"
@@ -50,6 +50,7 @@
 # define XMM128_LAST_IDX 0xF
 # define XMM256_SIZE 0x20
 # define XMM256_LAST_IDX 0x1F
+# define CACHE_LINE_SIZE 64
 static int CPUIDLeaf1[4] = {0};
 static int CPUIDLeaf7a[4] = {0};
 #else // Reserved for other architectures.
@@ -102,6 +103,13 @@ typedef intptr_t isz;
 # endif
 #endif
 
+#if defined(TT_GCC) || defined(TT_CLANG)
+# define align_as(Boundary) __attribute__((aligned(Boundary)))
+#elif defined(TT_MSVC)
+# define align_as(Boundary) __declspec(align(Boundary))
+#else // Reserved for other compilers.
+#endif
+
 #define Kilobyte(Number) Number * 1024ULL
 #define Megabyte(Number) Number * 1024ULL * 1024ULL
 #define Gigabyte(Number) Number * 1024ULL * 1024ULL * 1024ULL
@@ -205,6 +213,19 @@ GetFirstBitSet(u32 Mask)
     return Result;
 }
 
+internal inline i32
+GetFirstBitSet64(u64 Mask)
+{
+#if defined(TT_MSVC)
+    unsigned long Result;
+    _BitScanForward64(&Result, Mask);
+    return (i32)Result;
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    return __builtin_ctzll(Mask);
+#else // Reserved for other compiler intrinsics. 
+#endif
+}
+
 internal inline u32
 FlipBit(u32 Number, i32 BitIdx)
 {
@@ -223,15 +244,29 @@ FlipBit(u32 Number, i32 BitIdx)
 }
 
 internal inline usz
-RoundDownToPow2(i32 Value)
+RoundDownToPow2(usz Value)
+{
+    // Zero has no bit set, and counting its leading zeros is undefined.
+    if (Value == 0) return 0;
+#if defined(TT_MSVC)
+    i32 TrailingZero = 64-(i32)__lzcnt64(Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 TrailingZero = 64-__builtin_clzll(Value);
+#else // Reserved for other compiler intrinsics. 
+#endif
+    return (usz)1 << (TrailingZero-1);
+}
+
+internal inline i32
+GetLastBitSet(usz Value)
 {
 #if defined(TT_MSVC)
-    i32 TrailingZero = 64-__lzcnt(Value);
-#elif defined(TT_GCC)
-    i32 TrailingZero = 64-__builtin_clzl(Value);
+    i32 Result = 63-(i32)__lzcnt64(Value);
+#elif defined(TT_GCC) || defined(TT_CLANG)
+    i32 Result = 63-__builtin_clzll(Value);
 #else // Reserved for other compiler intrinsics. 
 #endif
-    return (usz)(1 << (TrailingZero-1));
+    return Result;
 }
 
 internal inline u32
@@ -241,6 +276,15 @@ ClearBit(u32 Value, i32 Bit)
     return Value;
 }
 
+internal inline void
+CpuPause(void)
+{
+#if defined(TT_X64)
+    _mm_pause();
+#else // Reserved for other architectures.
+#endif
+}
+
 internal inline f64
 Pow(f64 Base, f64 Exponent)
 {
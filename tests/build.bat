@@ -8,5 +8,7 @@ pushd ..\build
 call cl ..\tests\test-memory.c %CompileOpts% %LinkOpts%
 call cl ..\tests\test-strings.c %CompileOpts% %LinkOpts%
 call cl ..\tests\test-platform.cpp %CompileOpts% /EHa %LinkOpts%
+call cl ..\tests\test-queues.c %CompileOpts% %LinkOpts%
+call cl ..\tests\test-atomic.c %CompileOpts% %LinkOpts%
 call cl ..\tests\add.c /LD /Zi %LinkOpts% /DLL /EXPORT:AddTwo
 popd
\ No newline at end of file
@@ -5,6 +5,8 @@ set -u
 MEM='test-memory'
 STR='test-strings'
 PLT='test-platform'
+QUE='test-queues'
+ATM='test-atomic'
 DYN='add'
 CompileOpts='-I../src -g -Wall -mavx2 -fpermissive -lm -w'
 
@@ -13,5 +15,7 @@ cd ../build
 gcc -o ${MEM} ../tests/${MEM}.c ${CompileOpts}
 gcc -o ${STR} ../tests/${STR}.c ${CompileOpts}
 g++ -o ${PLT} ../tests/${PLT}.cpp ${CompileOpts}
+gcc -o ${QUE} ../tests/${QUE}.c ${CompileOpts}
+gcc -o ${ATM} ../tests/${ATM}.c ${CompileOpts}
 gcc -o ${DYN}.so ../tests/${DYN}.c ${CompileOpts} -shared
 cd ../tests
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "tinybase-atomic.h"
+
+#include <stdio.h>
+
+bool Error = false;
+#define Test(Callback, ...) \
+do { \
+if (!Test##Callback(__VA_ARGS__)) { \
+Error = true; \
+printf(" [%3d] %-40s ERRO.\n", __LINE__, #Callback"()"); } \
+} while (0); \
+
+
+//
+// Atomic tests
+//
+
+bool TestAtomicExplicit(void)
+{
+    align_as(8) i64 Value = 5;
+    bool Result = (AtomicExchange64Explicit(&Value, 7, ATOMIC_ACQ_REL) == 5
+                   && AtomicLoad64Explicit(&Value, ATOMIC_ACQUIRE) == 7
+                   && !AtomicCompareExchange64Explicit(&Value, 5, 9, ATOMIC_ACQ_REL)
+                   && AtomicCompareExchange64Explicit(&Value, 7, 9, ATOMIC_ACQ_REL)
+                   && AtomicAddFetch64Explicit(&Value, 3, ATOMIC_RELAXED) == 12
+                   && AtomicFetchOr64Explicit(&Value, 0x30, ATOMIC_RELEASE) == 12
+                   && AtomicFetchAnd64Explicit(&Value, 0x1C, ATOMIC_RELEASE) == 0x3C
+                   && AtomicFetchXor64Explicit(&Value, 0xFF, ATOMIC_RELAXED) == 0x1C
+                   && Value == 0xE3);
+    
+    i32 Value32 = 0;
+    AtomicStore32Explicit(&Value32, -1, ATOMIC_RELEASE);
+    Result = (Result && AtomicLoad32Explicit(&Value32, ATOMIC_ACQUIRE) == -1
+              && AtomicAddFetch32Explicit(&Value32, 2, ATOMIC_SEQ_CST) == 1);
+    
+    void* Ptr = NULL;
+    AtomicStorePtrExplicit(&Ptr, &Value, ATOMIC_RELEASE);
+    Result = (Result && AtomicLoadPtrExplicit(&Ptr, ATOMIC_ACQUIRE) == &Value
+              && AtomicCompareExchangePtrExplicit(&Ptr, &Value, &Value32, ATOMIC_SEQ_CST)
+              && AtomicExchangePtrExplicit(&Ptr, NULL, ATOMIC_ACQ_REL) == &Value32);
+    return Result;
+}
+
+bool TestAtomicCompareExchange128(void)
+{
+    align_as(16) i64 Value[2] = { 1, 2 };
+    i64 Compare[2] = { 1, 3 };
+    
+    // A failed exchange leaves [Dst] alone and loads it into [Compare].
+    bool Result = (!AtomicCompareExchange128(Value, Compare, 10, 20)
+                   && Value[0] == 1 && Value[1] == 2 && Compare[0] == 1 && Compare[1] == 2);
+    Result = (Result && AtomicCompareExchange128(Value, Compare, 10, 20)
+              && Value[0] == 10 && Value[1] == 20);
+    return Result;
+}
+
+
+//
+// Test program
+//
+
+int main()
+{
+    LoadSystemInfo();
+    
+    Test(AtomicExplicit);
+    Test(AtomicCompareExchange128);
+    
+    if (!Error) printf("All tests passed!\n");
+    return 0;
+}
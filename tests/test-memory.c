@@ -228,6 +228,115 @@ bool TestEquals(buffer A, buffer B, bool Expected)
     return Expected == EqualBuffers(A, B);
 }
 
+bool TestPushIntoArenaAligned(buffer* Arena, usz Size, usz Alignment, bool Expected)
+{
+    usz OldWriteCur = Arena->WriteCur;
+    u8* Result = (u8*)PushIntoArenaAligned(Arena, Size, Alignment);
+    if (Result)
+    {
+        return Expected && ((usz)Result & (Alignment-1)) == 0
+            && Result + Size == Arena->Base + Arena->WriteCur;
+    }
+    return !Expected && Arena->WriteCur == OldWriteCur;
+}
+
+bool TestArenaTemp(buffer* Arena)
+{
+    usz OldWriteCur = Arena->WriteCur;
+    arena_temp Outer = ArenaBeginTemp(Arena);
+    PushIntoArena(Arena, 10);
+    arena_temp Inner = ArenaBeginTemp(Arena);
+    PushIntoArena(Arena, 20);
+    ArenaEndTemp(Inner);
+    bool Result = (Arena->WriteCur == OldWriteCur + 10);
+    ArenaEndTemp(Outer);
+    return Result && Arena->WriteCur == OldWriteCur;
+}
+
+bool TestPool(void* Buf, usz BufSize, usz ObjectSize, usz ExpectedCount)
+{
+    pool Pool;
+    InitPool(&Pool, Buf, BufSize, ObjectSize);
+    
+    usz Count = 0;
+    void* First = PoolAlloc(&Pool);
+    void* Last = First;
+    for (void* Ptr = First; Ptr; Ptr = PoolAlloc(&Pool))
+    {
+        Last = Ptr;
+        Count++;
+    }
+    if (Count != ExpectedCount) return false;
+    
+    PoolFree(&Pool, First);
+    PoolFree(&Pool, Last);
+    return PoolAlloc(&Pool) == Last && PoolAlloc(&Pool) == First && PoolAlloc(&Pool) == NULL;
+}
+
+u8 TLSFExtraRegion[Kilobyte(16)];
+
+TLSF_GROW_PROC(GrowTLSFOnce)
+{
+    bool* Grown = (bool*)Arg;
+    if (*Grown || MinSize + TLSF_REGION_OVERHEAD > sizeof(TLSFExtraRegion)) return false;
+    *Grown = true;
+    return AddTLSFRegion(Allocator, TLSFExtraRegion, sizeof(TLSFExtraRegion));
+}
+
+bool TestTLSF(void* Buf, usz BufSize, usz NumRounds)
+{
+    tlsf Allocator;
+    bool Grown = false;
+    InitTLSF(&Allocator, GrowTLSFOnce, &Grown);
+    if (!AddTLSFRegion(&Allocator, Buf, BufSize)) return false;
+    
+    // Random allocs, reallocs and frees, checking no live region gets overwritten.
+    u8* Ptrs[64] = {0};
+    usz Sizes[64] = {0};
+    u32 Random = 0x12345678;
+    for (usz Round = 0; Round < NumRounds; Round++)
+    {
+        Random ^= Random << 13;
+        Random ^= Random >> 17;
+        Random ^= Random << 5;
+        usz Idx = Random % 64;
+        usz Size = (Random >> 8) % 2000 + 1;
+        if (Ptrs[Idx])
+        {
+            for (usz Byte = 0; Byte < Sizes[Idx]; Byte++)
+            {
+                if (Ptrs[Idx][Byte] != (u8)Idx) return false;
+            }
+        }
+        
+        if (Ptrs[Idx] && (Random & 0x80000000))
+        {
+            TLSFFree(&Allocator, Ptrs[Idx]);
+            Ptrs[Idx] = NULL;
+        }
+        else
+        {
+            u8* Ptr = (u8*)TLSFRealloc(&Allocator, Ptrs[Idx], Size);
+            if (Ptr)
+            {
+                if ((usz)Ptr & (TLSF_ALIGN-1)) return false;
+                memset(Ptr, (u8)Idx, Size);
+                Ptrs[Idx] = Ptr;
+                Sizes[Idx] = Size;
+            }
+        }
+    }
+    for (usz Idx = 0; Idx < 64; Idx++)
+    {
+        TLSFFree(&Allocator, Ptrs[Idx]);
+    }
+    
+    // With everything merged back, the whole region is one block again.
+    usz Whole = BufSize - TLSF_REGION_OVERHEAD;
+    void* Ptr = TLSFAlloc(&Allocator, Whole - (Whole >> TLSF_SL_SHIFT));
+    return Grown && Ptr == (u8*)Buf + 16 && TLSFAlloc(&Allocator, BufSize) == NULL;
+}
+
 
 //
 // Test program
@@ -313,6 +422,19 @@ int main()
     Test(CompareIdx, B4, B2, 5, 0);
     Test(Equals, B4, B5, false);
     
+    align_as(64) u8 ArenaMem[256];
+    buffer Arena = Buffer(ArenaMem, 1, sizeof(ArenaMem));
+    Test(PushIntoArenaAligned, &Arena, 16, 64, true);
+    Test(PushIntoArenaAligned, &Arena, 3, 1, true);
+    Test(PushIntoArenaAligned, &Arena, 32, 32, true);
+    Test(PushIntoArenaAligned, &Arena, 200, 128, false);
+    Test(ArenaTemp, &Arena);
+    Test(Pool, ArenaMem, sizeof(ArenaMem), 24, 10);
+    Test(Pool, ArenaMem, sizeof(ArenaMem), 3, 32);
+    
+    local align_as(16) u8 TLSFRegion[Kilobyte(64)];
+    Test(TLSF, TLSFRegion, sizeof(TLSFRegion), 5000);
+    
     if (!Error) printf("All tests passed!\n");
     return 0;
 }
\ No newline at end of file
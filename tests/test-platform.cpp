@@ -1,4 +1,6 @@
 #include "tinybase-platform.h"
+#include "tinybase-alloc.h"
+#include "tinybase-jobs.h"
 
 #include <stdio.h>
 
@@ -83,6 +85,531 @@ bool TestGetMemoryFromHeap(usz SizeToAllocate)
     return true;
 }
 
+bool TestCpuTopology(void)
+{
+    usz NumCpus = Min(gSysInfo.NumThreads, MAX_CPU_INFO);
+    bool Result = (gSysInfo.NumCores >= 1 && gSysInfo.NumCores <= gSysInfo.NumThreads
+                   && gSysInfo.NumNodes >= 1 && gSysInfo.CacheSizes[0] > 0);
+    for (usz Cpu = 0; Result && Cpu < NumCpus; Cpu++)
+    {
+        Result = (gSysInfo.Cpus[Cpu].Core < gSysInfo.NumCores
+                  && gSysInfo.Cpus[Cpu].Node < gSysInfo.NumNodes);
+    }
+    return Result;
+}
+
+bool TestGetMemoryOnNode(usz Size, i32 Node)
+{
+    buffer Mem = GetMemoryOnNode(Size, Node, MEM_WRITE);
+    if (!Mem.Base) return false;
+    Mem.Base[0] = Mem.Base[Size-1] = 1;
+    FreeMemory(&Mem);
+    return GetMemoryOnNode(Size, (i32)gSysInfo.NumNodes + 1000, MEM_WRITE).Base == NULL;
+}
+
+volatile u32 gChildThreadID = 0;
+volatile i32 gChildThreadExit = 0;
+
+THREAD_PROC(RecordThreadID)
+{
+    gChildThreadID = GetThreadID();
+    while (!gChildThreadExit) CpuPause();
+    return 0;
+}
+
+bool TestInitThreadEx(u64 Affinity, const char* Name)
+{
+    thread_options Options = DEFAULT_THREAD_OPTIONS;
+    Options.Affinity = Affinity;
+    Options.Name = Name;
+    Options.StackSize = Kilobyte(256);
+    thread Thread = InitThreadEx(RecordThreadID, NULL, &Options);
+    if (!Thread.Handle) return false;
+    
+    while (!gChildThreadID) CpuPause();
+    bool Result = (Thread.ID == gChildThreadID && Thread.ID != GetThreadID()
+                   && ChangeThreadScheduling(&Thread, SCHEDULE_LOW)
+                   && GetThreadScheduling(Thread) == SCHEDULE_LOW);
+    gChildThreadExit = 1;
+    return WaitOnThread(&Thread) && Result;
+}
+
+bool TestReserveMemory(usz ReserveSize, usz CommitSize)
+{
+    buffer Range = ReserveMemory(ReserveSize, NULL);
+    if (!Range.Base || Range.Size < ReserveSize) return false;
+    
+    u8* Middle = Range.Base + Range.Size/2;
+    bool Result = CommitMemory(Middle, CommitSize, MEM_WRITE|MEM_PREFAULT);
+    if (Result)
+    {
+        memset(Middle, 0xFF, CommitSize);
+        Result = (ProtectMemory(Middle, CommitSize, MEM_READ) && Middle[CommitSize-1] == 0xFF
+                  && DecommitMemory(Middle, CommitSize)
+                  && CommitMemory(Middle, CommitSize, MEM_WRITE)
+                  && Middle[0] == 0 && Middle[CommitSize-1] == 0);
+    }
+    FreeMemory(&Range);
+    return Result;
+}
+
+bool TestGetLockedMemory(usz Size)
+{
+    buffer Mem = GetMemory(Size, NULL, MEM_WRITE|MEM_PREFAULT|MEM_LOCK);
+    if (!Mem.Base) return false;
+    bool Result = (Mem.Base[0] == 0 && Mem.Base[Size-1] == 0);
+    FreeMemory(&Mem);
+    return Result;
+}
+
+bool TestGetHugePageMemory(usz Size)
+{
+    i32 Kind = -1;
+    buffer Mem = GetHugePageMemory(Size, NULL, MEM_WRITE, &Kind);
+    if (!Mem.Base) return false;
+    
+    usz PageSize = (gSysInfo.HugePageSizes[0]) ? gSysInfo.HugePageSizes[0] : Megabyte(2);
+    bool Result = (Mem.Size >= Size && (Kind == HUGEPAGE_NONE || Kind == HUGEPAGE_EXPLICIT
+                                        || Kind == HUGEPAGE_TRANSPARENT));
+    if (Kind != HUGEPAGE_NONE)
+    {
+        Result = Result && ((usz)Mem.Base & (PageSize-1)) == 0 && (Mem.Size & (PageSize-1)) == 0;
+    }
+    Mem.Base[0] = Mem.Base[Size-1] = 1;
+    FreeMemory(&Mem);
+    return Result;
+}
+
+bool TestVMArena(usz ReserveSize, usz CommitChunk)
+{
+    vm_arena Arena;
+    if (!ReserveVMArena(&Arena, ReserveSize, CommitChunk)) return false;
+    
+    bool Result = (Arena.Size == 0 && Arena.ReservedSize >= ReserveSize);
+    u8* First = (u8*)PushIntoVMArena(&Arena, 100);
+    u8* Second = (u8*)PushIntoVMArena(&Arena, CommitChunk * 3);
+    Result = Result && First && Second == First + 100
+        && Arena.WriteCur == 100 + CommitChunk * 3
+        && Arena.Size == CommitChunk * 4;
+    if (Result)
+    {
+        memset(First, 0xFF, Arena.WriteCur);
+        ResetVMArena(&Arena, true);
+        u8* Again = (u8*)PushIntoVMArena(&Arena, 100);
+        Result = (Again == First && Again[0] == 0 && Again[99] == 0
+                  && Arena.Size == CommitChunk);
+    }
+    Result = Result && PushIntoVMArena(&Arena, Arena.ReservedSize) == NULL;
+    
+    // Sizes that would wrap the write cursor around must fail too, and leave it alone.
+    usz WriteCur = Arena.WriteCur;
+    Result = (Result && PushIntoVMArena(&Arena, USZ_MAX - 50) == NULL
+              && PushIntoVMArenaAligned(&Arena, 1, (usz)1 << 62) == NULL
+              && Arena.WriteCur == WriteCur);
+    
+    FreeVMArena(&Arena);
+    return Result && Arena.Base == NULL;
+}
+
+bool TestGetScratchArena(void)
+{
+    vm_arena* First = GetScratchArena(NULL, 0);
+    if (!First) return false;
+    arena_temp Temp = ArenaBeginTemp(&First->Buffer);
+    u8* Data = (u8*)PushIntoVMArenaAligned(First, 100, 64);
+    
+    buffer* Conflicts[] = { &First->Buffer };
+    vm_arena* Second = GetScratchArena(Conflicts, 1);
+    bool Result = (Data && ((usz)Data & 63) == 0 && Second && Second != First
+                   && GetScratchArena(NULL, 0) == First);
+    
+    ArenaEndTemp(Temp);
+    Result = Result && First->WriteCur == Temp.WriteCur;
+    FreeScratchArenas();
+    return Result;
+}
+
+bool TestSlabAllocator(void)
+{
+    slab_allocator Slab;
+    InitSlabAllocator(&Slab);
+    
+    bool Result = true;
+    u8* Ptrs[2000];
+    for (usz Idx = 0; Idx < ArrayCount(Ptrs); Idx++)
+    {
+        usz Size = (Idx % 100) + 1;
+        Ptrs[Idx] = (u8*)SlabAlloc(&Slab, Size);
+        if (!Ptrs[Idx] || ((usz)Ptrs[Idx] & 15)) return false;
+        memset(Ptrs[Idx], (u8)Idx, Size);
+    }
+    for (usz Idx = 0; Idx < ArrayCount(Ptrs); Idx++)
+    {
+        usz Size = (Idx % 100) + 1;
+        Result = Result && Ptrs[Idx][0] == (u8)Idx && Ptrs[Idx][Size-1] == (u8)Idx;
+        SlabFree(&Slab, Ptrs[Idx], Size);
+    }
+    
+    // Freed objects are reused before new ones are carved.
+    Result = Result && SlabAlloc(&Slab, 100) == Ptrs[1999];
+    
+    u8* Large = (u8*)SlabAlloc(&Slab, SLAB_MAX_OBJECT+1);
+    Result = Result && Large && Large[SLAB_MAX_OBJECT] == 0;
+    SlabFree(&Slab, Large, SLAB_MAX_OBJECT+1);
+    
+    FreeSlabAllocator(&Slab);
+    return Result && Slab.Slabs == NULL;
+}
+
+bool TestGrowTLSFFromMemory(usz Size)
+{
+    tlsf Allocator;
+    InitTLSF(&Allocator, GrowTLSFFromMemory, NULL);
+    u8* First = (u8*)TLSFAlloc(&Allocator, 100);
+    u8* Big = (u8*)TLSFAlloc(&Allocator, Size);
+    if (!First || !Big) return false;
+    
+    // The big one does not fit in the first region, so it gets a region of its own.
+    Big[0] = Big[Size-1] = 1;
+    bool Result = (Big < First || Big >= First + TLSF_GROW_SIZE);
+    TLSFFree(&Allocator, Big);
+    TLSFFree(&Allocator, First);
+    
+    // The regions go back to the system, and the allocator can grow again afterwards.
+    Result = Result && Allocator.GrowArg != NULL;
+    FreeTLSF(&Allocator);
+    Result = Result && Allocator.GrowArg == NULL && Allocator.FlBitmap == 0;
+    First = (u8*)TLSFAlloc(&Allocator, 100);
+    Result = Result && First;
+    FreeTLSF(&Allocator);
+    return Result;
+}
+
+bool TestThreadAlloc(void)
+{
+    // Sizes are rounded up to a power of two, and each class is carved from its own span.
+    bool Result = (_GetAllocClass(1) == 0 && _GetAllocClass(ALLOC_MIN_OBJECT) == 0
+                   && _GetAllocClass(ALLOC_MIN_OBJECT+1) == 1
+                   && _GetAllocClass(ALLOC_MAX_OBJECT) == ALLOC_NUM_CLASSES-1);
+    u8* First = (u8*)ThreadAlloc(17);
+    u8* Second = (u8*)ThreadAlloc(32);
+    u8* Other = (u8*)ThreadAlloc(ALLOC_MAX_OBJECT);
+    if (!First || !Second || !Other) return false;
+    
+    alloc_span* Span = _GetAllocSpan(First);
+    Result = Result && Second == First + 32 && ((usz)First & 15) == 0
+        && Span == _GetAllocSpan(Second) && Span != _GetAllocSpan(Other)
+        && Span->Owner == _tAllocHeap && Span->Class == 1
+        && _GetAllocSpan(Other)->Class == ALLOC_NUM_CLASSES-1;
+    memset(Other, 0xFF, ALLOC_MAX_OBJECT);
+    
+    // Freed objects go back to the bin of their class, and are reused first.
+    ThreadFree(Second);
+    ThreadFree(First);
+    Result = Result && ThreadAlloc(20) == First && ThreadAlloc(32) == Second;
+    ThreadFree(First);
+    ThreadFree(Second);
+    ThreadFree(Other);
+    
+    // Large ones get a span of their own, with no owner.
+    u8* Large = (u8*)ThreadAlloc(ALLOC_MAX_OBJECT+1);
+    if (!Large) return false;
+    Large[0] = Large[ALLOC_MAX_OBJECT] = 1;
+    Span = _GetAllocSpan(Large);
+    Result = Result && (u8*)Span + ALLOC_SPAN_HEADER == Large
+        && Span->Class == ALLOC_CLASS_LARGE && Span->Owner == NULL;
+    ThreadFree(Large);
+    
+    Result = Result && ThreadAlloc(0) == NULL;
+    CloseThreadHeap();
+    return Result && _tAllocHeap == NULL;
+}
+
+#define REMOTE_FREE_COUNT 64
+
+void* gRemoteAllocs[REMOTE_FREE_COUNT];
+volatile i32 gRemoteStage = 0;
+volatile i32 gRemoteResult = 0;
+
+THREAD_PROC(AllocForRemoteFree)
+{
+    for (usz Idx = 0; Idx < REMOTE_FREE_COUNT; Idx++)
+    {
+        gRemoteAllocs[Idx] = ThreadAlloc(48);
+    }
+    alloc_heap* Heap = _tAllocHeap;
+    gRemoteStage = 1;
+    while (gRemoteStage != 2) CpuPause();
+    
+    // All objects were freed by the main thread, so they are in this heap's remote list, and
+    // come back in the next allocations instead of new ones being carved.
+    u32 Class = _GetAllocClass(48);
+    bool Result = (Heap->Bins[Class] == NULL);
+    u8* Carved = Heap->Spans[Class].Base + Heap->Spans[Class].WriteCur;
+    for (usz Idx = 0; Result && Idx < REMOTE_FREE_COUNT; Idx++)
+    {
+        void* Ptr = ThreadAlloc(64);
+        Result = (Ptr && Ptr != Carved);
+        for (usz Check = 0; Result && Check < REMOTE_FREE_COUNT; Check++)
+        {
+            if (gRemoteAllocs[Check] == Ptr) break;
+            Result = (Check+1 < REMOTE_FREE_COUNT);
+        }
+    }
+    Result = Result && !_CollectRemoteFrees(Heap);
+    
+    CloseThreadHeap();
+    gRemoteResult = (Result && _tAllocHeap == NULL) ? 1 : -1;
+    return 0;
+}
+
+bool TestThreadFreeRemote(void)
+{
+    thread Thread = InitThread(AllocForRemoteFree, NULL, true);
+    if (!Thread.Handle) return false;
+    
+    while (gRemoteStage != 1) CpuPause();
+    bool Result = true;
+    for (usz Idx = 0; Idx < REMOTE_FREE_COUNT; Idx++)
+    {
+        Result = (Result && gRemoteAllocs[Idx]
+                  && _GetAllocSpan(gRemoteAllocs[Idx])->Owner != _tAllocHeap);
+        ThreadFree(gRemoteAllocs[Idx]);
+    }
+    gRemoteStage = 2;
+    
+    while (!gRemoteResult) CpuPause();
+    return WaitOnThread(&Thread) && Result && gRemoteResult == 1;
+}
+
+typedef struct sum_range
+{
+    i64 Lo, Hi;
+    job Job;
+} sum_range;
+
+job_system gJobSystem;
+sum_range gSumRanges[4096];
+i64 gNextSumRange = 0;
+i64 gSumTotal = 0;
+
+JOB_PROC(SumRange)
+{
+    // Splits the range in two child jobs until it is small enough to add up.
+    sum_range* Range = (sum_range*)Arg;
+    if (Range->Hi - Range->Lo <= 256)
+    {
+        i64 Sum = 0;
+        for (i64 Value = Range->Lo; Value < Range->Hi; Value++) Sum += Value;
+        AtomicAddFetch64(&gSumTotal, Sum);
+        return;
+    }
+    
+    i64 Mid = (Range->Lo + Range->Hi) / 2;
+    sum_range* Left = &gSumRanges[AtomicAddFetch64(&gNextSumRange, 1)];
+    sum_range* Right = &gSumRanges[AtomicAddFetch64(&gNextSumRange, 1)];
+    Left->Lo = Range->Lo, Left->Hi = Mid;
+    Right->Lo = Mid, Right->Hi = Range->Hi;
+    InitJob(&Left->Job, SumRange, Left, &Range->Job);
+    InitJob(&Right->Job, SumRange, Right, &Range->Job);
+    RunJob(&gJobSystem, &Left->Job);
+    RunJob(&gJobSystem, &Right->Job);
+}
+
+bool TestJobSystem(usz NumThreads, i64 Count)
+{
+    // The number of workers comes from gSysInfo, so it is forced here to get some stealing
+    // going even on machines with few cores.
+    usz SysThreads = gSysInfo.NumThreads;
+    gSysInfo.NumThreads = NumThreads;
+    buffer Arena = GetMemory(Megabyte(1), NULL, MEM_WRITE);
+    bool Result = InitJobSystem(&gJobSystem, &Arena, 64);
+    gSysInfo.NumThreads = SysThreads;
+    if (!Result) return false;
+    
+    // A parent with no proc groups two jobs, each of which spawns a tree of children.
+    for (usz Round = 0; Result && Round < 10; Round++)
+    {
+        job Parent;
+        InitJob(&Parent, NULL, NULL, NULL);
+        gSumTotal = 0;
+        gNextSumRange = 1;
+        sum_range* First = &gSumRanges[0];
+        sum_range* Second = &gSumRanges[1];
+        First->Lo = 0, First->Hi = Count/2;
+        Second->Lo = Count/2, Second->Hi = Count;
+        InitJob(&First->Job, SumRange, First, &Parent);
+        InitJob(&Second->Job, SumRange, Second, &Parent);
+        Result = (RunJob(&gJobSystem, &First->Job) && RunJob(&gJobSystem, &Second->Job)
+                  && RunJob(&gJobSystem, &Parent));
+        
+        WaitOnJob(&gJobSystem, &Parent);
+        Result = (Result && IsJobDone(&Parent) && IsJobDone(&Second->Job)
+                  && gSumTotal == Count * (Count-1) / 2);
+    }
+    
+    CloseJobSystem(&gJobSystem);
+    FreeMemory(&Arena);
+    return Result;
+}
+
+typedef struct rwlock_arg
+{
+    rwlock Lock;
+    u32 Entered;
+    usz A, B;
+    bool Torn;
+} rwlock_arg;
+
+THREAD_PROC(EnterForReading)
+{
+    rwlock_arg* Shared = (rwlock_arg*)Arg;
+    LockForReading(&Shared->Lock);
+    AtomicStore32(&Shared->Entered, 1);
+    WakeFutex(&Shared->Entered, true);
+    UnlockForReading(&Shared->Lock);
+    return 0;
+}
+
+THREAD_PROC(EnterForWriting)
+{
+    rwlock_arg* Shared = (rwlock_arg*)Arg;
+    LockForWriting(&Shared->Lock);
+    AtomicStore32(&Shared->Entered, 1);
+    WakeFutex(&Shared->Entered, true);
+    UnlockForWriting(&Shared->Lock);
+    return 0;
+}
+
+THREAD_PROC(WriteAndReadPairs)
+{
+    // Writers bump both counters, and readers check they are never seen halfway through.
+    rwlock_arg* Shared = (rwlock_arg*)Arg;
+    for (usz Round = 0; Round < 20000; Round++)
+    {
+        if (Round % 4 == 0)
+        {
+            LockForWriting(&Shared->Lock);
+            Shared->A++;
+            CpuPause();
+            Shared->B++;
+            UnlockForWriting(&Shared->Lock);
+        }
+        else
+        {
+            LockForReading(&Shared->Lock);
+            if (Shared->A != Shared->B) Shared->Torn = true;
+            UnlockForReading(&Shared->Lock);
+        }
+    }
+    return 0;
+}
+
+bool TestRWLock(void)
+{
+    // A second reader gets in while the first holds the lock.
+    rwlock_arg Shared = {0};
+    LockForReading(&Shared.Lock);
+    thread Reader = InitThread(EnterForReading, &Shared, true);
+    for (usz Tries = 0; Tries < 100 && !AtomicLoad32(&Shared.Entered); Tries++)
+    {
+        WaitOnFutex(&Shared.Entered, 0, 20);
+    }
+    bool Result = (AtomicLoad32(&Shared.Entered) == 1);
+    UnlockForReading(&Shared.Lock);
+    Result = Reader.Handle && WaitOnThread(&Reader) && Result;
+    
+    // A writer is kept out for as long as a reader holds it.
+    Shared.Entered = 0;
+    LockForReading(&Shared.Lock);
+    thread Writer = InitThread(EnterForWriting, &Shared, true);
+    WaitOnFutex(&Shared.Entered, 0, 100);
+    Result = Result && AtomicLoad32(&Shared.Entered) == 0;
+    UnlockForReading(&Shared.Lock);
+    Result = Writer.Handle && WaitOnThread(&Writer) && Result && Shared.Entered == 1;
+    
+    thread Threads[4];
+    for (usz Idx = 0; Idx < 4; Idx++)
+    {
+        Threads[Idx] = InitThread(WriteAndReadPairs, &Shared, true);
+    }
+    for (usz Idx = 0; Idx < 4; Idx++)
+    {
+        Result = Threads[Idx].Handle && WaitOnThread(&Threads[Idx]) && Result;
+    }
+    return (Result && !Shared.Torn && Shared.A == 4 * 5000 && Shared.B == Shared.A
+            && Shared.Lock.State == 0);
+}
+
+typedef struct condvar_arg
+{
+    mutex Mutex;
+    condvar Cond;
+    u32 Waiting;
+    u32 Woken;
+    bool Go;
+} condvar_arg;
+
+THREAD_PROC(WaitForGo)
+{
+    condvar_arg* Shared = (condvar_arg*)Arg;
+    LockOnMutex(&Shared->Mutex);
+    Shared->Waiting++;
+    while (!Shared->Go)
+    {
+        WaitOnCondVar(&Shared->Cond, &Shared->Mutex, TIMEOUT_INFINITE);
+    }
+    Shared->Woken++;
+    UnlockMutex(&Shared->Mutex);
+    return 0;
+}
+
+bool TestCondVar(usz NumWaiters, bool Broadcast)
+{
+    condvar_arg Shared = {0};
+    thread Threads[4];
+    for (usz Idx = 0; Idx < NumWaiters; Idx++)
+    {
+        Threads[Idx] = InitThread(WaitForGo, &Shared, true);
+    }
+    
+    // The flag is only set once every waiter is in, so none of them can skip the wait.
+    bool AllIn = false;
+    for (usz Tries = 0; !AllIn && Tries < 1000; Tries++)
+    {
+        LockOnMutex(&Shared.Mutex);
+        u32 Waiting = Shared.Waiting;
+        UnlockMutex(&Shared.Mutex);
+        AllIn = (Waiting == NumWaiters);
+        if (!AllIn) WaitOnFutex(&Shared.Waiting, (i32)Waiting, 1);
+    }
+    
+    LockOnMutex(&Shared.Mutex);
+    Shared.Go = true;
+    UnlockMutex(&Shared.Mutex);
+    if (Broadcast)
+    {
+        BroadcastCondVar(&Shared.Cond);
+    }
+    else
+    {
+        // Each signal wakes at least one waiter, so one per waiter gets them all out.
+        for (usz Idx = 0; Idx < NumWaiters; Idx++) SignalCondVar(&Shared.Cond);
+    }
+    
+    bool Result = AllIn;
+    for (usz Idx = 0; Idx < NumWaiters; Idx++)
+    {
+        Result = Threads[Idx].Handle && WaitOnThread(&Threads[Idx]) && Result;
+    }
+    
+    // Nobody signals this time, so the wait runs out.
+    LockOnMutex(&Shared.Mutex);
+    bool TimedOut = !WaitOnCondVar(&Shared.Cond, &Shared.Mutex, 10);
+    UnlockMutex(&Shared.Mutex);
+    return Result && TimedOut && Shared.Woken == NumWaiters && Shared.Mutex.State == 0;
+}
+
 bool TestCreateNewFile(void* Filename)
 {
     file File = CreateNewFile(Filename, 0);
@@ -133,6 +660,216 @@ bool TestReadFromFile(file FileHandle, usz StartPos, usz AmountToRead, buffer Ex
     return (false == Expected2);
 }
 
+bool TestFileAsync(file FileHandle, buffer Content)
+{
+    async Write, Read;
+    if (!WriteFileAsync(FileHandle, Content.Base, Content.WriteCur, 0, &Write)
+        || WaitOnIoCompletion(FileHandle, &Write, true) != Content.WriteCur)
+    {
+        return false;
+    }
+    
+    buffer Mem = GetMemory(Content.WriteCur, 0, MEM_READ|MEM_WRITE);
+    bool Result = (Mem.Base
+                   && ReadFileAsync(FileHandle, &Mem, Content.WriteCur, 0, &Read)
+                   && WaitOnIoCompletion(FileHandle, &Read, true) == Content.WriteCur
+                   && EqualBuffers(Mem, Content));
+    FreeMemory(&Mem);
+    return Result;
+}
+
+bool TestIoBatch(file FileHandle, buffer Content)
+{
+    // Registration fails where io_uring is not available, and the reads must work anyway.
+    buffer Mem = GetMemory(Content.WriteCur, 0, MEM_READ|MEM_WRITE);
+    RegisterIoBuffers(&Mem, 1);
+    RegisterIoFiles(&FileHandle, 1);
+    
+    async Reads[2];
+    usz Half = Content.WriteCur / 2;
+    BeginIoBatch();
+    bool Result = (ReadFileAsync(FileHandle, &Mem, Half, 0, &Reads[0])
+                   && ReadFileAsync(FileHandle, &Mem, Content.WriteCur - Half, Half, &Reads[1])
+                   && EndIoBatch()
+                   && WaitOnIoCompletion(FileHandle, &Reads[1], true) == Content.WriteCur - Half
+                   && WaitOnIoCompletion(FileHandle, &Reads[0], true) == Half
+                   && EqualBuffers(Mem, Content));
+    
+    CloseAsyncIo();
+    FreeMemory(&Mem);
+    return Result;
+}
+
+typedef struct async_arg
+{
+    file File;
+    buffer Content;
+    bool Result;
+} async_arg;
+
+THREAD_PROC(WriteAsyncAndExit)
+{
+    // Leaves without CloseAsyncIo(), so the ring must be released on thread exit.
+    async_arg* Async = (async_arg*)Arg;
+    async Write;
+    Async->Result = (WriteFileAsync(Async->File, Async->Content.Base, Async->Content.WriteCur, 0, &Write)
+                     && WaitOnIoCompletion(Async->File, &Write, true) == Async->Content.WriteCur);
+    return 0;
+}
+
+usz CountOpenFiles(void)
+{
+    usz Count = 0;
+#if defined(TT_LINUX)
+    DIR* Dir = opendir("/proc/self/fd");
+    if (Dir)
+    {
+        while (readdir(Dir)) Count++;
+        closedir(Dir);
+    }
+#endif
+    return Count;
+}
+
+bool TestFileAsyncThreadExit(file FileHandle, buffer Content)
+{
+    async_arg Arg = { FileHandle, Content, false };
+    usz OpenBefore = CountOpenFiles();
+    bool Result = true;
+    for (usz Round = 0; Round < 4; Round++)
+    {
+        thread Thread = InitThread(WriteAsyncAndExit, &Arg, true);
+        Result = Result && Thread.Handle && WaitOnThread(&Thread) && Arg.Result;
+    }
+    return Result && CountOpenFiles() == OpenBefore;
+}
+
+bool TestIoQueue(void* Filename, buffer Content)
+{
+    io_queue Queue;
+    if (!InitIoQueue(&Queue, 8)) return false;
+    
+    // Opens and closes are checked on their own, since the other operations need the handle.
+    io_completion Done[4];
+    file File = INVALID_FILE;
+    if (QueueFileOpen(&Queue, Filename, READ_SHARE|WRITE_SHARE|ASYNC_FILE, &File)
+        && WaitForCompletions(&Queue, Done, 1, 4, TIMEOUT_INFINITE) == 1
+        && Done[0].UserData == &File && Done[0].Result >= 0)
+    {
+        File = (file)Done[0].Result;
+    }
+    
+    char Dst[2][64] = {0};
+    usz Half = Content.WriteCur / 2;
+    bool Result = (File != INVALID_FILE
+                   && QueueFileWrite(&Queue, File, Content.Base, Content.WriteCur, 0, NULL)
+                   && QueueFileSync(&Queue, File, NULL)
+                   && WaitForCompletions(&Queue, Done, 2, 4, 1000) == 2
+                   && QueueFileRead(&Queue, File, Dst[0], Half, 0, Dst[0])
+                   && QueueFileRead(&Queue, File, Dst[1], 64, Half, Dst[1])
+                   && SubmitIoQueue(&Queue));
+    
+    u32 Count = 0;
+    while (Result && Count < 2)
+    {
+        Count += WaitForCompletions(&Queue, Done + Count, 1, 2 - Count, TIMEOUT_INFINITE);
+    }
+    for (u32 Idx = 0; Result && Idx < 2; Idx++)
+    {
+        // The second read goes past EOF, so it comes back short.
+        char* Read = (char*)Done[Idx].UserData;
+        usz Offset = (Read == Dst[0]) ? 0 : Half;
+        usz Expected = (Read == Dst[0]) ? Half : Content.WriteCur - Half;
+        Result = (Done[Idx].Result == (isz)Expected
+                  && memcmp(Read, Content.Base + Offset, Expected) == 0);
+    }
+    
+    Result = (Result
+              && QueueFileClose(&Queue, File, NULL)
+              && WaitForCompletions(&Queue, Done, 1, 4, TIMEOUT_INFINITE) == 1
+              && Done[0].Result == 0
+              && WaitForCompletions(&Queue, Done, 0, 4, 0) == 0);
+    CloseIoQueue(&Queue);
+    return Result;
+}
+
+bool TestIoQueueTruncate(void* Filename, buffer Content)
+{
+    file Existing = CreateNewFile(Filename, WRITE_SHARE|FORCE_CREATE);
+    if (Existing == INVALID_FILE) return false;
+    bool Written = WriteEntireFile(Existing, Content);
+    CloseFileHandle(Existing);
+    
+    io_queue Queue;
+    if (!Written || !InitIoQueue(&Queue, 4)) return false;
+    
+    // The existing file must come back empty, the same as with OpenFileHandle().
+    io_completion Done[1];
+    bool Result = (QueueFileOpen(&Queue, Filename, READ_SHARE|WRITE_SHARE|FORCE_CREATE, NULL)
+                   && WaitForCompletions(&Queue, Done, 1, 1, TIMEOUT_INFINITE) == 1
+                   && Done[0].Result >= 0);
+    if (Result)
+    {
+        file File = (file)Done[0].Result;
+        Result = (FileSizeOf(File) == 0);
+        CloseFileHandle(File);
+    }
+    CloseIoQueue(&Queue);
+    return RemoveFile(Filename) && Result;
+}
+
+bool TestBuffersToFile(file FileHandle, buffer Content, usz Split)
+{
+    buffer Parts[3] = { Buffer(Content.Base, Split, Split), Buffer(NULL, 0, 0),
+                        Buffer(Content.Base + Split, Content.WriteCur - Split, 0) };
+    if (WriteBuffersToFile(FileHandle, Parts, 3, 0, IO_DSYNC) != Content.WriteCur)
+    {
+        return false;
+    }
+    
+    // The file is longer than the buffers, so they are filled, and the read past EOF stops.
+    u8 Mem[3][64];
+    Parts[0] = Buffer(Mem[0], 0, Split);
+    Parts[1] = Buffer(Mem[1], 0, Content.WriteCur - Split);
+    Parts[2] = Buffer(Mem[2], 0, 64);
+    usz Read = ReadIntoBuffers(FileHandle, Parts, 3, 0, 0);
+    bool Result = (Read != USZ_MAX
+                   && Read >= Content.WriteCur
+                   && Parts[2].WriteCur == Read - Content.WriteCur
+                   && memcmp(Mem[0], Content.Base, Split) == 0
+                   && memcmp(Mem[1], Content.Base + Split, Content.WriteCur - Split) == 0);
+    return Result;
+}
+
+bool TestMapFile(file FileHandle, buffer Content, usz Offset)
+{
+    buffer Map = MapFile(FileHandle, Offset, 0, MAPPED_WRITE|MAPPED_POPULATE);
+    if (!Map.Base
+        || Map.WriteCur != Content.WriteCur - Offset
+        || memcmp(Map.Base, Content.Base + Offset, Map.WriteCur) != 0)
+    {
+        return false;
+    }
+    
+    // Writes to a shared mapping land in the file, and private ones do not.
+    Map.Base[0] = '#';
+    bool Result = FlushMappedRange(Map.Base, 1);
+    UnmapFile(&Map);
+    
+    buffer Copy = MapEntireFile(FileHandle, MAPPED_COPY|MAPPED_SEQUENTIAL);
+    Result = (Result && Copy.Base && Copy.WriteCur == Content.WriteCur
+              && Copy.Base[Offset] == '#');
+    if (Copy.Base) Copy.Base[Offset] = Content.Base[Offset];
+    UnmapFile(&Copy);
+    
+    buffer Check = MapFile(FileHandle, Offset, 1, MAPPED_READ);
+    Result = (Result && Check.Base && Check.Base[0] == '#');
+    UnmapFile(&Check);
+    
+    WriteToFile(FileHandle, Buffer(Content.Base + Offset, 1, 1), Offset);
+    return Result && (Map.Base == NULL);
+}
+
 bool TestReadEntireFile(file FileHandle, buffer Expected1, bool Expected2)
 {
     buffer File = ReadEntireFile(FileHandle);
@@ -195,6 +932,62 @@ bool TestDuplicateFile(void* SrcPath, void* DstPath, bool OverwriteIfExists, boo
     return Result == Expected;
 }
 
+#define APPEND_CHUNK 100
+#define APPEND_ROUNDS 500
+
+typedef struct append_arg
+{
+    file File;
+    u8 Byte;
+} append_arg;
+
+THREAD_PROC(AppendChunks)
+{
+    append_arg* Append = (append_arg*)Arg;
+    u8 Chunk[APPEND_CHUNK];
+    memset(Chunk, Append->Byte, sizeof(Chunk));
+    buffer Content = Buffer(Chunk, sizeof(Chunk), sizeof(Chunk));
+    for (usz Round = 0; Round < APPEND_ROUNDS; Round++)
+    {
+        if (!AppendToFile(Append->File, Content)) break;
+    }
+    return 0;
+}
+
+bool TestAppendToFileConcurrent(void* Filename)
+{
+    file File = CreateNewFile(Filename, READ_SHARE|WRITE_SHARE|FORCE_CREATE);
+    if (File == INVALID_FILE) return false;
+    
+    // Two threads append through the same handle; if both ever saw the same EOF, one chunk
+    // would overwrite the other and the file would come up short.
+    append_arg Args[2] = { { File, 'a' }, { File, 'b' } };
+    thread Threads[2];
+    for (usz Idx = 0; Idx < 2; Idx++)
+    {
+        Threads[Idx] = InitThread(AppendChunks, &Args[Idx], true);
+    }
+    bool Result = true;
+    for (usz Idx = 0; Idx < 2; Idx++)
+    {
+        Result = Result && Threads[Idx].Handle && WaitOnThread(&Threads[Idx]);
+    }
+    
+    buffer Data = ReadEntireFile(File);
+    usz Count[2] = {0};
+    for (usz Idx = 0; Idx < Data.WriteCur; Idx++)
+    {
+        if (Data.Base[Idx] == 'a') Count[0]++;
+        else if (Data.Base[Idx] == 'b') Count[1]++;
+    }
+    Result = (Result && Data.WriteCur == 2 * APPEND_CHUNK * APPEND_ROUNDS
+              && Count[0] == APPEND_CHUNK * APPEND_ROUNDS
+              && Count[1] == APPEND_CHUNK * APPEND_ROUNDS);
+    FreeMemory(&Data);
+    CloseFileHandle(File);
+    return RemoveFile(Filename) && Result;
+}
+
 bool TestRemoveFile(void* Filename, bool Expected)
 {
     return RemoveFile(Filename) == Expected;
@@ -381,6 +1174,22 @@ int main()
     Test(GetMemoryGuard, gSysInfo.PageSize, NULL);
     Test(GetMemoryFromHeap, 100);
 #endif
+    Test(CpuTopology);
+    Test(GetMemoryOnNode, Megabyte(1), gSysInfo.Cpus[0].Node);
+    Test(ReserveMemory, Megabyte(1), Kilobyte(64));
+    Test(InitThreadEx, 1, "test-thread");
+    Test(GetLockedMemory, Kilobyte(64));
+    Test(GetHugePageMemory, Megabyte(3));
+    Test(VMArena, Gigabyte(64), Kilobyte(64));
+    Test(GetScratchArena);
+    Test(SlabAllocator);
+    Test(GrowTLSFFromMemory, Megabyte(3));
+    Test(ThreadAlloc);
+    Test(ThreadFreeRemote);
+    Test(JobSystem, 4, 200000);
+    Test(RWLock);
+    Test(CondVar, 1, false);
+    Test(CondVar, 3, true);
     
     // FileIO
     file File;
@@ -401,13 +1210,22 @@ int main()
     Test(WriteToFile, File, FileNewText, 20);
     Test(ReadFromFile, File, 20, 10, FileNewText, true);
     Test(ReadFromFile, File, 21, 11, FileNewText, false);
+    Test(ReadFromFile, File, 30, 10, FileNewText, false);
+    Test(BuffersToFile, File, FileNewText, 4);
+    Test(FileAsync, File, FileBaseText);
+    Test(IoBatch, File, FileBaseText);
+    Test(FileAsyncThreadExit, File, FileBaseText);
     Test(FilesAreEqual, __VFILE__, __VFILE__, true);
     Test(FilesAreEqual, __VFILE__, _TempA, false);
     Test(DuplicateFile, __VFILE__, _TempC, false, true);
     Test(DuplicateFile, __VFILE__, _TempC, true, true);
     Test(DuplicateFile, __VFILE__, _TempC, false, false);
+    Test(IoQueue, _TempA, FileBaseText);
+    Test(IoQueueTruncate, _TempD, FileBaseText);
+    Test(MapFile, File, FileBaseText, 5);
     Test(RemoveFile, _TempA, true);
     Test(RemoveFile, _TempD, false);
+    Test(AppendToFileConcurrent, _TempD);
     
     // Filesystem
     char DirPathBuf[MAX_PATH_SIZE] = {0};
@@ -0,0 +1,422 @@
+#include "tinybase-queues.h"
+
+#include <stdio.h>
+
+bool Error = false;
+#define Test(Callback, ...) \
+do { \
+if (!Test##Callback(__VA_ARGS__)) { \
+Error = true; \
+printf(" [%3d] %-40s ERRO.\n", __LINE__, #Callback"()"); } \
+} while (0); \
+
+typedef struct test_node
+{
+    struct test_node* volatile Next;
+    usz Value;
+} test_node;
+
+
+//
+// Queue tests
+//
+
+bool TestRoundDownToPow2(void)
+{
+    // Ring capacities are rounded with this, so zero must not reach the bit scan.
+    return (RoundDownToPow2(0) == 0 && RoundDownToPow2(1) == 1 && RoundDownToPow2(2) == 2
+            && RoundDownToPow2(3) == 2 && RoundDownToPow2(1000) == 512
+            && RoundDownToPow2(USZ_MAX) == (usz)1 << 63);
+}
+
+bool TestMPSCFreeList(void)
+{
+    mpsc_freelist Queue;
+    InitMPSCFreeList(&Queue);
+    test_node Nodes[4] = {0};
+    
+    // Nodes come out in the order they were pushed.
+    MPSCFreeListPush(&Queue, &Nodes[0]);
+    Nodes[1].Next = &Nodes[2];
+    Nodes[2].Next = &Nodes[3];
+    MPSCFreeListPushChain(&Queue, &Nodes[1], &Nodes[3]);
+    bool Result = true;
+    for (usz Idx = 0; Idx < ArrayCount(Nodes); Idx++)
+    {
+        Result = Result && MPSCFreeListPop(&Queue) == (mpsc_node*)&Nodes[Idx];
+    }
+    Result = Result && MPSCFreeListPop(&Queue) == NULL;
+    
+    MPSCFreeListPush(&Queue, &Nodes[0]);
+    Result = (Result && MPSCFreeListPopWait(&Queue, 10) == (mpsc_node*)&Nodes[0]
+              && MPSCFreeListPopWait(&Queue, 10) == NULL);
+    return Result;
+}
+
+bool TestSPSCRingBuffer(void)
+{
+    void* Ptrs[8];
+    spsc_ringbuf Queue;
+    if (!InitSPSCRingBuffer(&Queue, Ptrs, sizeof(Ptrs), sizeof(void*))) return false;
+    
+    // Several laps around the ring, filling it each time.
+    bool Result = true;
+    for (usz Lap = 0; Result && Lap < 3; Lap++)
+    {
+        for (usz Idx = 0; Idx < ArrayCount(Ptrs); Idx++)
+        {
+            Result = Result && SPSCRingBufferPush(&Queue, (void*)(Lap*100 + Idx + 1));
+        }
+        Result = Result && !SPSCRingBufferPush(&Queue, (void*)1);
+        for (usz Idx = 0; Idx < ArrayCount(Ptrs); Idx++)
+        {
+            Result = Result && SPSCRingBufferPop(&Queue) == (void*)(Lap*100 + Idx + 1);
+        }
+        Result = Result && SPSCRingBufferPop(&Queue) == NULL;
+    }
+    
+    // Inline records, with a buffer that fits five, rounded down to four.
+    u64 Records[3*5];
+    Result = Result && InitSPSCRingBuffer(&Queue, Records, sizeof(Records), 3*sizeof(u64));
+    for (usz Idx = 0; Result && Idx < 20; Idx++)
+    {
+        u64 In[3] = { Idx, Idx*2, Idx*3 }, Out[3] = {0};
+        Result = (SPSCRingBufferWrite(&Queue, In) && SPSCRingBufferRead(&Queue, Out)
+                  && Out[0] == Idx && Out[1] == Idx*2 && Out[2] == Idx*3);
+    }
+    Result = Result && !InitSPSCRingBuffer(&Queue, Records, 8, 3*sizeof(u64));
+    return Result;
+}
+
+bool TestBroadcastRingBuffer(void)
+{
+    align_as(CACHE_LINE_SIZE) u8 Buf[2*sizeof(broadcast_cursor) + 4*sizeof(u64)];
+    broadcast_ringbuf Queue;
+    if (!InitBroadcastRingBuffer(&Queue, Buf, sizeof(Buf), sizeof(u64), 2)) return false;
+    
+    bool Result = true;
+    for (u64 Idx = 0; Idx < 4; Idx++)
+    {
+        u64* Slot = (u64*)BroadcastRingBufferClaim(&Queue);
+        Result = Result && Slot;
+        if (Slot) *Slot = Idx;
+        BroadcastRingBufferPublish(&Queue);
+    }
+    Result = Result && BroadcastRingBufferClaim(&Queue) == NULL;
+    
+    // Both subscribers see every item, and slots free up only once the slowest is done.
+    for (u64 Idx = 0; Result && Idx < 4; Idx++)
+    {
+        u64* Item = (u64*)BroadcastRingBufferRead(&Queue, 0);
+        Result = Item && *Item == Idx;
+        BroadcastRingBufferRelease(&Queue, 0);
+    }
+    Result = (Result && BroadcastRingBufferRead(&Queue, 0) == NULL
+              && BroadcastRingBufferClaim(&Queue) == NULL);
+    u64* Item = (u64*)BroadcastRingBufferRead(&Queue, 1);
+    Result = Result && Item && *Item == 0;
+    BroadcastRingBufferRelease(&Queue, 1);
+    return Result && BroadcastRingBufferClaim(&Queue) != NULL;
+}
+
+bool TestMPMCRingBuffer(void)
+{
+    mpmc_cell Cells[8];
+    mpmc_ringbuf Queue;
+    if (!InitMPMCRingBuffer(&Queue, Cells, sizeof(Cells))) return false;
+    
+    bool Result = true;
+    for (usz Idx = 0; Idx < ArrayCount(Cells); Idx++)
+    {
+        Result = Result && MPMCRingBufferPush(&Queue, (void*)(Idx+1));
+    }
+    Result = Result && !MPMCRingBufferPush(&Queue, (void*)1);
+    for (usz Idx = 0; Idx < ArrayCount(Cells); Idx++)
+    {
+        Result = Result && MPMCRingBufferPop(&Queue) == (void*)(Idx+1);
+    }
+    
+    // NULL items can be told apart from an empty queue with the try variant.
+    void* Item = (void*)1;
+    Result = (Result && MPMCRingBufferPush(&Queue, NULL)
+              && MPMCRingBufferTryPop(&Queue, &Item) && Item == NULL
+              && !MPMCRingBufferTryPop(&Queue, &Item)
+              && !MPMCRingBufferPopWait(&Queue, &Item, 10));
+    
+    // Batches push as many as fit, and pop as many as there are.
+    void* Items[12];
+    for (usz Idx = 0; Idx < ArrayCount(Items); Idx++) Items[Idx] = (void*)(Idx+1);
+    Result = (Result && MPMCRingBufferPush(&Queue, Items[0])
+              && MPMCRingBufferPushN(&Queue, Items+1, 11) == 7
+              && MPMCRingBufferPopN(&Queue, Items, 3) == 3 && Items[0] == (void*)1
+              && Items[2] == (void*)3 && MPMCRingBufferPopN(&Queue, Items, 12) == 5
+              && Items[4] == (void*)8 && MPMCRingBufferPopN(&Queue, Items, 12) == 0);
+    return Result;
+}
+
+bool TestWSDeque(void)
+{
+    void* Ptrs[8];
+    ws_deque Queue;
+    if (!InitWSDeque(&Queue, Ptrs, sizeof(Ptrs))) return false;
+    
+    // The owner pops the newest items, and thieves steal the oldest.
+    bool Result = true;
+    for (usz Idx = 0; Idx < ArrayCount(Ptrs); Idx++)
+    {
+        Result = Result && WSDequePush(&Queue, (void*)(Idx+1));
+    }
+    Result = (Result && !WSDequePush(&Queue, (void*)1)
+              && WSDequeSteal(&Queue) == (void*)1 && WSDequeSteal(&Queue) == (void*)2
+              && WSDequePop(&Queue) == (void*)8 && WSDequePop(&Queue) == (void*)7
+              && WSDequePush(&Queue, (void*)9) && WSDequePop(&Queue) == (void*)9);
+    for (usz Idx = 3; Idx <= 6; Idx++)
+    {
+        Result = Result && WSDequeSteal(&Queue) == (void*)Idx;
+    }
+    Result = (Result && WSDequePop(&Queue) == NULL && WSDequeSteal(&Queue) == NULL
+              && WSDequePush(&Queue, (void*)10) && WSDequeSteal(&Queue) == (void*)10);
+    return Result;
+}
+
+bool TestMPMCStack(void)
+{
+    mpmc_stack Stack;
+    InitMPMCStack(&Stack);
+    test_node Nodes[6] = {0};
+    
+    MPMCStackPush(&Stack, &Nodes[0]);
+    Nodes[1].Next = &Nodes[2];
+    MPMCStackPushChain(&Stack, &Nodes[1], &Nodes[2]);
+    MPMCStackPush(&Stack, &Nodes[3]);
+    usz Tag = Stack.Tag;
+    bool Result = (MPMCStackPop(&Stack) == (mpsc_node*)&Nodes[3] && Stack.Tag != Tag);
+    
+    // A batch pop returns a NULL-terminated chain, from the top down.
+    usz Count = 0;
+    mpsc_node* Chain = MPMCStackPopN(&Stack, 2, &Count);
+    Result = (Result && Count == 2 && Chain == (mpsc_node*)&Nodes[1]
+              && Chain->Next == (mpsc_node*)&Nodes[2] && Chain->Next->Next == NULL);
+    Chain = MPMCStackPopN(&Stack, 5, &Count);
+    Result = (Result && Count == 1 && Chain == (mpsc_node*)&Nodes[0]
+              && MPMCStackPop(&Stack) == NULL && MPMCStackPopN(&Stack, 5, &Count) == NULL);
+    return Result;
+}
+
+bool TestStackMagazine(usz Capacity)
+{
+    mpmc_stack Depot;
+    InitMPMCStack(&Depot);
+    stack_magazine Magazine;
+    InitStackMagazine(&Magazine, &Depot, Capacity);
+    test_node Nodes[20] = {0};
+    
+    // Pushing past capacity moves half of the magazine to the depot.
+    for (usz Idx = 0; Idx <= Capacity; Idx++)
+    {
+        StackMagazinePush(&Magazine, &Nodes[Idx]);
+    }
+    bool Result = (Magazine.Count == Capacity - Capacity/2 + 1 && Depot.Head != NULL);
+    
+    // Popping everything refills from the depot, and each node comes out once.
+    usz Popped = 0;
+    for (test_node* Node; (Node = (test_node*)StackMagazinePop(&Magazine)) != NULL; Popped++)
+    {
+        Result = Result && Node >= Nodes && Node <= &Nodes[Capacity] && Node->Value == 0;
+        Node->Value = 1;
+    }
+    Result = Result && Popped == Capacity + 1 && Depot.Head == NULL;
+    
+    StackMagazinePush(&Magazine, &Nodes[0]);
+    StackMagazinePush(&Magazine, &Nodes[1]);
+    FlushStackMagazine(&Magazine);
+    Result = (Result && Magazine.Count == 0 && Magazine.Items == NULL
+              && MPMCStackPop(&Depot) == (mpsc_node*)&Nodes[1]);
+    return Result;
+}
+
+usz gReclaimed = 0;
+
+EPOCH_RECLAIM_PROC(CountReclaimed)
+{
+    for (mpsc_node* Node = First; Node; Node = (Node == Last) ? NULL : Node->Next)
+    {
+        gReclaimed++;
+    }
+}
+
+bool TestEpochDomain(void)
+{
+    align_as(CACHE_LINE_SIZE) epoch_record Records[2];
+    epoch_domain Domain;
+    if (!InitEpochDomain(&Domain, Records, sizeof(Records), CountReclaimed, NULL)) return false;
+    
+    epoch_record* Writer = AcquireEpochRecord(&Domain);
+    epoch_record* Reader = AcquireEpochRecord(&Domain);
+    bool Result = (Writer && Reader && Writer != Reader && AcquireEpochRecord(&Domain) == NULL);
+    if (!Result) return false;
+    
+    // While the reader sits in the epoch the node was retired in, the node is kept.
+    test_node Nodes[3] = {0};
+    EnterEpoch(&Domain, Reader);
+    RetireEpochNode(&Domain, Writer, &Nodes[0]);
+    for (usz Idx = 0; Idx < 4; Idx++)
+    {
+        CollectEpoch(&Domain, Writer);
+    }
+    Result = (gReclaimed == 0 && Domain.Epoch == 1);
+    
+    ExitEpoch(Reader);
+    CollectEpoch(&Domain, Writer);
+    Result = Result && gReclaimed == 1 && Domain.Epoch == 2;
+    
+    // Nodes left over are handed back on close.
+    RetireEpochNode(&Domain, Writer, &Nodes[1]);
+    RetireEpochNode(&Domain, Reader, &Nodes[2]);
+    ReleaseEpochRecord(&Domain, Reader);
+    ReleaseEpochRecord(&Domain, Writer);
+    CloseEpochDomain(&Domain);
+    return Result && gReclaimed == 3;
+}
+
+
+bool TestEpochRetireThrottle(void)
+{
+    align_as(CACHE_LINE_SIZE) epoch_record Records[2];
+    epoch_domain Domain;
+    InitEpochDomain(&Domain, Records, sizeof(Records), CountReclaimed, NULL);
+    epoch_record* Writer = AcquireEpochRecord(&Domain);
+    epoch_record* Reader = AcquireEpochRecord(&Domain);
+    
+    // With the reader stuck, collecting can advance the epoch only once, and after that it's
+    // not retried on every retire, but only after another batch.
+    local test_node Nodes[3*EPOCH_RETIRE_THRESHOLD];
+    gReclaimed = 0;
+    EnterEpoch(&Domain, Reader);
+    for (usz Idx = 0; Idx < 2*EPOCH_RETIRE_THRESHOLD; Idx++)
+    {
+        RetireEpochNode(&Domain, Writer, &Nodes[Idx]);
+    }
+    bool Result = (gReclaimed == 0 && Domain.Epoch == 1
+                   && Writer->NextCollect == 2*EPOCH_RETIRE_THRESHOLD + 1);
+    
+    // Once the reader leaves, the next batch frees everything retired two epochs back.
+    ExitEpoch(Reader);
+    for (usz Idx = 2*EPOCH_RETIRE_THRESHOLD; Idx < ArrayCount(Nodes); Idx++)
+    {
+        RetireEpochNode(&Domain, Writer, &Nodes[Idx]);
+    }
+    Result = Result && gReclaimed > 0;
+    
+    ReleaseEpochRecord(&Domain, Reader);
+    ReleaseEpochRecord(&Domain, Writer);
+    CloseEpochDomain(&Domain);
+    return Result && gReclaimed == ArrayCount(Nodes);
+}
+
+//
+// Multithreaded tests
+//
+
+#define SMOKE_ITEMS 100000
+#define SMOKE_THREADS 2
+
+mpmc_ringbuf gSmokeQueue;
+mpmc_stack gSmokeStack;
+i64 gSmokeSum = 0;
+i64 gSmokePopped = 0;
+
+THREAD_PROC(SmokeProducer)
+{
+    usz First = (usz)Arg * SMOKE_ITEMS;
+    for (usz Idx = First; Idx < First + SMOKE_ITEMS; Idx++)
+    {
+        while (!MPMCRingBufferPush(&gSmokeQueue, (void*)(Idx+1))) CpuPause();
+    }
+    return 0;
+}
+
+THREAD_PROC(SmokeConsumer)
+{
+    i64 Sum = 0;
+    void* Item;
+    while (AtomicLoad64(&gSmokePopped) < SMOKE_THREADS * SMOKE_ITEMS)
+    {
+        if (!MPMCRingBufferPopWait(&gSmokeQueue, &Item, 10)) continue;
+        
+        // Every item also goes through the shared stack, to race its pushes and pops.
+        test_node* Node = (test_node*)MPMCStackPop(&gSmokeStack);
+        if (Node)
+        {
+            Node->Value++;
+            MPMCStackPush(&gSmokeStack, Node);
+        }
+        Sum += (i64)Item;
+        AtomicAddFetch64(&gSmokePopped, 1);
+    }
+    AtomicAddFetch64(&gSmokeSum, Sum);
+    return 0;
+}
+
+bool TestMPMCSmoke(void)
+{
+    local mpmc_cell Cells[256];
+    local test_node Nodes[16];
+    InitMPMCRingBuffer(&gSmokeQueue, Cells, sizeof(Cells));
+    InitMPMCStack(&gSmokeStack);
+    for (usz Idx = 0; Idx < ArrayCount(Nodes); Idx++)
+    {
+        MPMCStackPush(&gSmokeStack, &Nodes[Idx]);
+    }
+    
+    thread Threads[2*SMOKE_THREADS];
+    for (usz Idx = 0; Idx < SMOKE_THREADS; Idx++)
+    {
+        Threads[Idx] = InitThread(SmokeProducer, (void*)Idx, true);
+        Threads[SMOKE_THREADS+Idx] = InitThread(SmokeConsumer, NULL, true);
+    }
+    bool Result = true;
+    for (usz Idx = 0; Idx < ArrayCount(Threads); Idx++)
+    {
+        Result = Result && Threads[Idx].Handle && WaitOnThread(&Threads[Idx]);
+    }
+    
+    // Every item was popped exactly once, and no stack node was lost or duplicated.
+    i64 Count = SMOKE_THREADS * SMOKE_ITEMS;
+    Result = Result && gSmokePopped == Count && gSmokeSum == Count * (Count+1) / 2;
+    usz Touched = 0, NumNodes = 0;
+    for (test_node* Node; (Node = (test_node*)MPMCStackPop(&gSmokeStack)) != NULL; NumNodes++)
+    {
+        Touched += Node->Value;
+    }
+    return Result && NumNodes == ArrayCount(Nodes) && Touched == (usz)Count;
+}
+
+
+//
+// Test program
+//
+
+int main()
+{
+    LoadSystemInfo();
+    
+    // Queues
+    Test(RoundDownToPow2);
+    Test(MPSCFreeList);
+    Test(SPSCRingBuffer);
+    Test(BroadcastRingBuffer);
+    Test(MPMCRingBuffer);
+    Test(WSDeque);
+    Test(MPMCStack);
+    Test(StackMagazine, 8);
+    Test(StackMagazine, 5);
+    Test(EpochDomain);
+    Test(EpochRetireThrottle);
+    
+    // Multithreaded
+    Test(MPMCSmoke);
+    
+    if (!Error) printf("All tests passed!\n");
+    return 0;
+}